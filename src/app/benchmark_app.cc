@@ -12,10 +12,6 @@
 #include <strutils.hh>
 #include <stringf.hh>
 
-#ifdef SYNTH_USE_TBB
-#include <tbb/tbb.h>
-#endif
-
 #include <memory>
 #include <functional>
 #include <fstream>
@@ -40,11 +36,22 @@ int BenchmarkApp::run (int argc, const char* argv[]) {
 
     // ........................................................................
 
+    // Micro benchmark
+    if (argt(argc, argv, "--micro")) {
+        m_Instruments = args(argc, argv, "--instruments",
+                             "examples/02_envelope.xml");
+        return runMicro(args(argc, argv, "--micro", ""));
+    }
+
+    // ........................................................................
+
     size_t sampleRate = argi(argc, argv, "--sample-rate", 48000);
     size_t bufferSize = argi(argc, argv, "--period",      256);
+    size_t quantum    = argi(argc, argv, "--quantum",     bufferSize);
 
     m_Logger->info("SampleRate: {}", sampleRate);
     m_Logger->info("BufferSize: {}", bufferSize);
+    m_Logger->info("Quantum   : {}", quantum);
 
     // ........................................................................
 
@@ -53,11 +60,15 @@ int BenchmarkApp::run (int argc, const char* argv[]) {
         throw std::runtime_error("Specify the '--instruments' option!");
     }
     
-    m_Instruments.update(Instrument::loadInstruments(
-        args(argc, argv, "--instruments", nullptr),
-        sampleRate,
-        bufferSize
-    ));
+    m_Engine.reset(new Engine::Engine(sampleRate, quantum));
+    if (argt(argc, argv, "--deterministic")) {
+        m_Engine->setDeterministic(true, argi(argc, argv, "--seed", 0));
+    }
+    m_Engine->setVoiceLimits(
+        argi(argc, argv, "--max-voices", 0),
+        (size_t)argi(argc, argv, "--max-memory", 0) * 1024 * 1024
+    );
+    m_Engine->loadInstruments(args(argc, argv, "--instruments", nullptr));
 
     // ........................................................................
 
@@ -76,8 +87,6 @@ int BenchmarkApp::run (int argc, const char* argv[]) {
 
     int64_t trigSample = bufferSize / 2;
 
-    std::vector<Instrument::Voice*> activeVoices;
-
     // Begin the benchmark
     m_Logger->info("Running benchmark...");
     int64_t timeStart = Utils::makeTimestamp();
@@ -101,7 +110,7 @@ int BenchmarkApp::run (int argc, const char* argv[]) {
             }
 
             // Send events to instruments
-            for (auto it : m_Instruments) {
+            for (auto it : m_Engine->getInstruments()) {
                 auto instr = it.second;
 
                 // TODO
@@ -139,36 +148,12 @@ int BenchmarkApp::run (int argc, const char* argv[]) {
                 [](MIDI::Event& a, MIDI::Event& b) {return a.time < b.time;});
         }
 
-        // Clear the active buffer
-        masterMix.clear();
-
-        // Build a list of all active voices
-        activeVoices.clear();
-        for (auto& it : m_Instruments) {
-            auto& instr = it.second;
-            instr->processEvents(midiEvents, activeVoices);
+        // Render the period
+        for (auto& event : midiEvents) {
+            m_Engine->pushEvent(event);
         }
 
-        // Process voices
-#ifdef SYNTH_USE_TBB
-        tbb::parallel_for( tbb::blocked_range<size_t>(0, activeVoices.size()),
-            [=](const tbb::blocked_range<size_t>& r) {
-                for (size_t i=r.begin(); i!=r.end(); ++i) {
-                    auto& voice = activeVoices[i];
-                    voice->process();
-                }
-            }
-        );
-#else
-        for (auto& voice : activeVoices) {
-            voice->process();
-        }
-#endif
-
-        // Downmix
-        for (auto& voice : activeVoices) {
-            masterMix += voice->getBuffer();
-        }
+        m_Engine->render(masterMix.data(0), masterMix.data(1), bufferSize);
 
         // Record audio
         if (recorder.isRecording()) {
@@ -187,5 +172,13 @@ int BenchmarkApp::run (int argc, const char* argv[]) {
     m_Logger->info("Audio time  : {}ms", audioTime);
     m_Logger->info("Ratio       : x{:.3f}", (double)audioTime / (double)timeElapsed);
 
+    // Voice pool statistics
+    const auto& stats = m_Engine->getVoiceStats();
+    m_Logger->info("Voices      : {} live, {} peak, {:.1f}kB",
+        stats.liveVoices, stats.peakVoices, stats.memory / 1024.0);
+    m_Logger->info("Voice pool  : {} hits, {} misses, {} reclaims, {} refusals",
+        stats.hits, stats.misses, stats.reclaims, stats.refusals);
+    m_Logger->info("Voice builds: {:.3f}ms", stats.buildTime * 1e3);
+
     return 0;
 }
@@ -1,11 +1,12 @@
 #ifndef APP_BENCHMARK_HH
 #define APP_BENCHMARK_HH
 
-#include <instrument/factory.hh>
+#include <engine/engine.hh>
 
 #include <spdlog/spdlog.h>
 
 #include <memory>
+#include <string>
 
 // ============================================================================
 
@@ -19,11 +20,30 @@ public:
 
 protected:
 
+    /// Runs a micro benchmark of the given name. Returns non-zero on failure
+    int runMicro (const std::string& a_Name);
+
+    /// Fast math accuracy check and speed benchmark
+    int microMath ();
+    /// Biquad coefficient table accuracy and modulated filter benchmark
+    int microBiquad ();
+    /// Runtime versus fixed buffer size module kernel benchmark
+    int microKernels ();
+    /// Checks that re-striking a note held by the sustain pedal retriggers
+    /// its envelope on the same voice
+    int microPedal ();
+    /// Checks that sampler playback continues correctly across loop points
+    /// and that one-shot waveforms start in silence
+    int microSampler ();
+
+    /// Instrument definitions used by checks that need a whole instrument
+    std::string m_Instruments;
+
     /// Logger
     std::shared_ptr<spdlog::logger> m_Logger;
 
-    /// Instruments
-    Instrument::Instruments m_Instruments;
+    /// Synthesis engine
+    std::unique_ptr<Engine::Engine> m_Engine;
 };
 
 #endif // APP_BENCHMARK_HH
@@ -0,0 +1,692 @@
+#include "benchmark_app.hh"
+
+#include <utils/utils.hh>
+#include <utils/math.hh>
+
+#include <audio/buffer.hh>
+#include <audio/kernels.hh>
+#include <midi/event.hh>
+
+#include <graph/processing/biquad_iir.hh>
+#include <graph/processing/biquad_lut.hh>
+#include <graph/processing/sampler.hh>
+
+#include <graph/modules/adder.hh>
+#include <graph/modules/mixer.hh>
+#include <graph/modules/vga.hh>
+#include <graph/modules/vco.hh>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include <sndfile.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+// ============================================================================
+
+namespace {
+
+/// Prevents the compiler from optimizing benchmarked computations away
+volatile float g_Sink = 0.0f;
+
+/// Runs the function repeatedly, returns the time per sample in ns
+double measure (std::function<void()> a_Func, size_t a_Samples,
+                size_t a_Iterations)
+{
+    // Warm up
+    a_Func();
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i=0; i<a_Iterations; ++i) {
+        a_Func();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    return ns / (double)(a_Samples * a_Iterations);
+}
+
+}; // Anonymous
+
+// ============================================================================
+
+int BenchmarkApp::runMicro (const std::string& a_Name) {
+
+    if (a_Name == "math") {
+        return microMath();
+    }
+    if (a_Name == "biquad") {
+        return microBiquad();
+    }
+    if (a_Name == "kernels") {
+        return microKernels();
+    }
+    if (a_Name == "pedal") {
+        return microPedal();
+    }
+    if (a_Name == "sampler") {
+        return microSampler();
+    }
+
+    m_Logger->error("Unknown micro benchmark '{}'", a_Name);
+    m_Logger->error("Available ones are: math, biquad, kernels, pedal, sampler");
+    return -1;
+}
+
+// ============================================================================
+
+int BenchmarkApp::microMath () {
+
+    using namespace Utils;
+
+    int failed = 0;
+
+    // Reports an accuracy check result
+    auto report = [&](const char* name, double error, double bound) {
+        bool pass = error <= bound;
+        if (pass) {
+            m_Logger->info ("{:<24} max. error {:.3e} (bound {:.1e}) OK",
+                name, error, bound);
+        } else {
+            m_Logger->error("{:<24} max. error {:.3e} (bound {:.1e}) FAIL",
+                name, error, bound);
+            failed++;
+        }
+    };
+
+    // ........................................................................
+    // Accuracy against libm (computed in double precision)
+
+    m_Logger->info("Accuracy:");
+
+    double maxError = 0.0;
+    for (double x = -126.0; x <= 127.0; x += 1e-4) {
+        float  y = Math::fastExp2((float)x);
+        double r = std::exp2((double)(float)x);
+        maxError = std::max(maxError, std::fabs(y - r) / r);
+    }
+    report("exp2 (relative)", maxError, 2e-7);
+
+    maxError = 0.0;
+    for (int x = -126; x <= 127; ++x) {
+        float  y = Math::fastExp2((float)x);
+        double r = std::exp2((double)x);
+        maxError = std::max(maxError, std::fabs(y - r) / r);
+    }
+    report("exp2 (integers)", maxError, 0.0);
+
+    maxError = 0.0;
+    for (double x = 1e-3; x <= 1e3; x *= 1.00001) {
+        float  y = Math::fastLog2((float)x);
+        double r = std::log2((double)(float)x);
+        maxError = std::max(maxError, std::fabs(y - r));
+    }
+    report("log2 (absolute)", maxError, 6e-7);
+
+    maxError = 0.0;
+    for (double g = -120.0; g <= 24.0; g += 1e-3) {
+        float  y = Math::fastLog2lin((float)g);
+        double r = std::pow(10.0, (double)(float)g / 20.0);
+        maxError = std::max(maxError, std::fabs(y - r) / r);
+    }
+    report("log2lin (relative)", maxError, 1e-6);
+
+    maxError = 0.0;
+    for (double cv = -2.0; cv <= 10.0; cv += 1e-5) {
+        float  y = Math::fastCvToFrequency((float)cv);
+        double r = 27.5 * std::exp2((double)(float)cv);
+        maxError = std::max(maxError, std::fabs(y - r) / r);
+    }
+    report("cvToFrequency (relative)", maxError, 5e-7);
+
+    // ........................................................................
+    // Speed
+
+    const size_t size       = 256;
+    const size_t iterations = 200000;
+
+    std::vector<float> src (size);
+    std::vector<float> dst (size);
+
+    std::mt19937 gen (1);
+    std::uniform_real_distribution<float> dist (-96.0f, 6.0f);
+    for (auto& x : src) {
+        x = dist(gen);
+    }
+
+    m_Logger->info("Speed ({} samples x {} iterations):", size, iterations);
+
+    // Reports a speed comparison
+    auto compare = [&](const char* name,
+                       std::function<void()> libm,
+                       std::function<void()> fast)
+    {
+        double tLibm = measure(libm, size, iterations);
+        g_Sink = g_Sink + dst[0];
+        double tFast = measure(fast, size, iterations);
+        g_Sink = g_Sink + dst[0];
+
+        m_Logger->info("{:<24} libm {:.3f} ns, fast {:.3f} ns, x{:.2f}",
+            name, tLibm, tFast, tLibm / tFast);
+    };
+
+    compare("log2lin",
+        [&]() {
+            for (size_t i=0; i<size; ++i) dst[i] = Math::log2lin(src[i]);
+        },
+        [&]() {
+            Math::log2lin(dst.data(), src.data(), size);
+        }
+    );
+
+    compare("cvToFrequency",
+        [&]() {
+            for (size_t i=0; i<size; ++i) dst[i] = cvToFrequency(src[i]);
+        },
+        [&]() {
+            Math::cvToFrequency(dst.data(), src.data(), size);
+        }
+    );
+
+    for (auto& x : src) {
+        x = std::fabs(x) + 1e-3f;
+    }
+
+    compare("log2",
+        [&]() {
+            for (size_t i=0; i<size; ++i) dst[i] = log2f(src[i]);
+        },
+        [&]() {
+            Math::log2(dst.data(), src.data(), size);
+        }
+    );
+
+    return failed ? -1 : 0;
+}
+
+// ============================================================================
+
+int BenchmarkApp::microBiquad () {
+
+    using namespace Utils;
+    using Graph::Processing::BiquadIIR;
+    using Graph::Processing::BiquadLUT;
+
+    const float  sampleRate  = 48000.0f;
+    const size_t resolutions[] = {4, 8, 16, 32};
+
+    // ........................................................................
+    // Table accuracy against the direct computation. Reports the maximum
+    // absolute error of normalized coefficients.
+
+    m_Logger->info("Accuracy:");
+
+    struct Type {
+        const char*                 name;
+        BiquadIIR::ComputeFunction  func;
+        bool                        usesGain;
+    };
+
+    const Type types[] = {
+        {"lpf",       BiquadIIR::computeLPF,       false},
+        {"peaking",   BiquadIIR::computePeak,      true },
+        {"highShelf", BiquadIIR::computeHighShelf, true },
+    };
+
+    for (auto& type : types) {
+        for (size_t resolution : resolutions) {
+
+            auto lut = BiquadLUT::get(type.func, type.usesGain, sampleRate,
+                                      resolution);
+
+            std::mt19937 gen (1);
+            std::uniform_real_distribution<float> cvDist   ( 0.0f,  9.0f);
+            std::uniform_real_distribution<float> qDist    ( 0.5f, 10.0f);
+            std::uniform_real_distribution<float> gainDist (-12.0f, 12.0f);
+
+            double maxError = 0.0;
+            for (size_t i=0; i<100000; ++i) {
+                float cv   = cvDist(gen);
+                float q    = qDist(gen);
+                float gain = type.usesGain ? gainDist(gen) : 0.0f;
+
+                auto r = BiquadIIR::normalize(
+                    type.func(cvToFrequency(cv), gain, q, sampleRate)
+                );
+                auto y = lut->lookup(cv, gain, q);
+
+                maxError = std::max(maxError, (double)std::fabs(y.a1 - r.a1));
+                maxError = std::max(maxError, (double)std::fabs(y.a2 - r.a2));
+                maxError = std::max(maxError, (double)std::fabs(y.b0 - r.b0));
+                maxError = std::max(maxError, (double)std::fabs(y.b1 - r.b1));
+                maxError = std::max(maxError, (double)std::fabs(y.b2 - r.b2));
+            }
+
+            m_Logger->info("{:<10} resolution {:>2} max. error {:.3e}",
+                type.name, resolution, maxError);
+        }
+    }
+
+    // ........................................................................
+    // Per-sample cost with the cutoff modulated every sample
+
+    const size_t size       = 256;
+    const size_t iterations = 20000;
+
+    std::vector<float> cv  (size);
+    std::vector<float> src (size);
+    std::vector<float> dst (size);
+
+    std::mt19937 gen (1);
+    std::uniform_real_distribution<float> dist (-1.0f, 1.0f);
+    for (size_t i=0; i<size; ++i) {
+        cv[i]  = 5.0f + 2.0f * sinf(6.2831f * (float)i / (float)size);
+        src[i] = dist(gen);
+    }
+
+    m_Logger->info("Speed ({} samples x {} iterations):", size, iterations);
+
+    BiquadIIR filter;
+    const float q = 0.707f;
+
+    double tStatic = measure([&]() {
+        filter.process(dst.data(), src.data(), size);
+    }, size, iterations);
+    g_Sink = g_Sink + dst[0];
+
+    m_Logger->info("{:<24} {:.3f} ns", "static", tStatic);
+
+    double tDirect = measure([&]() {
+        for (size_t i=0; i<size; ++i) {
+            float f = Math::fastCvToFrequency(cv[i]);
+            filter.setCoeffs(BiquadIIR::computeLPF(f, 0.0f, q, sampleRate));
+            dst[i] = filter.process(src[i]);
+        }
+    }, size, iterations);
+    g_Sink = g_Sink + dst[0];
+
+    m_Logger->info("{:<24} {:.3f} ns", "modulated, direct", tDirect);
+
+    for (size_t resolution : resolutions) {
+        auto lut = BiquadLUT::get(BiquadIIR::computeLPF, false, sampleRate,
+                                  resolution);
+
+        double tLut = measure([&]() {
+            for (size_t i=0; i<size; ++i) {
+                filter.setCoeffs(lut->lookup(cv[i], 0.0f, q));
+                dst[i] = filter.process(src[i]);
+            }
+        }, size, iterations);
+        g_Sink = g_Sink + dst[0];
+
+        m_Logger->info("{:<24} {:.3f} ns, x{:.2f}",
+            fmt::format("modulated, LUT {}", resolution), tLut,
+            tDirect / tLut);
+    }
+
+    return 0;
+}
+
+// ============================================================================
+
+int BenchmarkApp::microKernels () {
+
+    using namespace Graph;
+
+    const float  sampleRate = 48000.0f;
+    const size_t sizes[]    = {32, 64, 128, 256};
+    const size_t samples    = 1 << 22;
+
+    // Modules under test. Inputs are left unconnected so they read their
+    // default values.
+    Module::Attributes inputs;
+    inputs.set("numInputs", "4");
+
+    struct Type {
+        const char*              name;
+        std::function<Module*()> create;
+    };
+
+    const Type types[] = {
+        {"adder", [&]() { return new Modules::Adder("adder", inputs); }},
+        {"mixer", [&]() { return new Modules::Mixer("mixer", inputs); }},
+        {"vga",   [&]() { return new Modules::VGA  ("vga"); }},
+        {"vco",   [&]() { return new Modules::VCO  ("vco"); }},
+    };
+
+    // ........................................................................
+    // Fixed and runtime size multiply-accumulate must match bit for bit
+
+    m_Logger->info("Multiply-accumulate, fixed against runtime size ({}):",
+        Audio::Kernels::getImplementation());
+
+    struct Mac {
+        size_t size;
+        void   (*fixed) (float*, const float*, float, size_t);
+    };
+
+    const Mac macs[] = {
+        {32,  &Audio::Kernels::Fixed<32> ::mac},
+        {64,  &Audio::Kernels::Fixed<64> ::mac},
+        {128, &Audio::Kernels::Fixed<128>::mac},
+        {256, &Audio::Kernels::Fixed<256>::mac},
+    };
+
+    std::mt19937 gen (1);
+    std::uniform_real_distribution<float> dist (-1.0f, 1.0f);
+
+    int failed = 0;
+    for (auto& mac : macs) {
+
+        std::vector<float> src     (mac.size);
+        std::vector<float> runtime (mac.size);
+        std::vector<float> fixed   (mac.size);
+
+        size_t mismatches = 0;
+        for (size_t n=0; n<1000; ++n) {
+            for (size_t i=0; i<mac.size; ++i) {
+                src[i]     = dist(gen);
+                runtime[i] = fixed[i] = dist(gen);
+            }
+            const float k = dist(gen);
+
+            Audio::Kernels::mac(runtime.data(), src.data(), k, mac.size);
+            mac.fixed(fixed.data(), src.data(), k, mac.size);
+
+            if (memcmp(runtime.data(), fixed.data(),
+                       mac.size * sizeof(float)) != 0)
+            {
+                mismatches++;
+            }
+        }
+
+        const std::string name = "mac " + std::to_string(mac.size);
+        if (mismatches == 0) {
+            m_Logger->info ("{:<24} identical OK", name);
+        } else {
+            m_Logger->error("{:<24} {} of 1000 blocks differ FAIL", name,
+                mismatches);
+            failed++;
+        }
+    }
+
+    // ........................................................................
+
+    m_Logger->info("Per-sample cost of runtime and fixed size kernels:");
+
+    for (auto& type : types) {
+        for (size_t size : sizes) {
+
+            double t[2];
+            for (size_t fixed=0; fixed<2; ++fixed) {
+                Module::setFixedSizeKernels(fixed != 0);
+
+                std::unique_ptr<Module> module (type.create());
+                module->prepare(sampleRate, size);
+                module->start();
+
+                t[fixed] = measure([&]() {
+                    module->process();
+                }, size, samples / size);
+            }
+
+            m_Logger->info("{:<8} {:>3} runtime {:.3f} ns, fixed {:.3f} ns, x{:.2f}",
+                type.name, size, t[0], t[1], t[0] / t[1]);
+        }
+    }
+
+    Module::setFixedSizeKernels(true);
+    return failed ? -1 : 0;
+}
+
+// ============================================================================
+
+int BenchmarkApp::microPedal () {
+
+    const size_t size = 256;
+
+    Engine::Engine engine (48000, size);
+    engine.loadInstruments(m_Instruments);
+
+    Audio::Buffer<float>     output (size, 2);
+    std::vector<MIDI::Event> events;
+
+    auto note = [&](MIDI::Event::Type type) {
+        MIDI::Event event;
+        event.type = type;
+        event.time = 0;
+        event.data.note.channel     = 0;
+        event.data.note.note        = 60;
+        event.data.note.velocity[0] = 100;
+        event.data.note.velocity[1] = 100;
+        event.data.note.duration    = 0;
+        events.push_back(event);
+    };
+
+    auto sustain = [&](int32_t value) {
+        MIDI::Event event;
+        event.type = MIDI::Event::Type::CONTROLLER;
+        event.time = 0;
+        event.data.ctrl.channel = 0;
+        event.data.ctrl.param   = 64;
+        event.data.ctrl.value   = value;
+        events.push_back(event);
+    };
+
+    // Processes buffers, returns the output peak
+    auto run = [&](size_t a_Count) {
+        float peak = 0.0f;
+        for (size_t i=0; i<a_Count; ++i) {
+            engine.process(events, output);
+            events.clear();
+
+            peak = std::max(peak, Audio::Kernels::peak(output.data(0), size));
+        }
+        return peak;
+    };
+
+    // Play a note into its sustain, release it with the pedal down, then
+    // strike it again.
+    note(MIDI::Event::Type::NOTE_ON);
+    run(40);
+    float played = run(4);
+
+    sustain(127);
+    note(MIDI::Event::Type::NOTE_OFF);
+    run(20);
+    float held = run(4);
+
+    // Notes are served from idle voices, spares are built in advance
+    uint64_t before = engine.getVoiceStats().hits;
+    note(MIDI::Event::Type::NOTE_ON);
+    float struck = run(8);
+
+    uint64_t after = engine.getVoiceStats().hits;
+
+    m_Logger->info("sustained peak {:.3f}, held {:.3f}, re-struck {:.3f}, voices taken {} -> {}",
+        played, held, struck, before, after);
+
+    // The pedal keeps the level, the new attack overshoots the sustain
+    // level and the held voice is reused instead of taking another one.
+    bool pass = held   >= 0.9f * played &&
+                struck >= 1.5f * played &&
+                after  == before;
+
+    if (pass) {
+        m_Logger->info ("{:<24} OK",   "pedal re-strike");
+    } else {
+        m_Logger->error("{:<24} FAIL", "pedal re-strike");
+    }
+
+    return pass ? 0 : -1;
+}
+
+// ============================================================================
+
+int BenchmarkApp::microSampler () {
+
+    using Graph::Processing::Sampler;
+
+    const size_t size   = 6000;
+    const size_t start  = 2000;
+    const size_t period = 64;
+    const size_t end    = start + 30 * period;
+    const double omega  = 2.0 * 3.141592653589793 / (double)period;
+
+    // Writes a mono waveform to a file
+    auto write = [&](const std::string& a_Name,
+                     const std::vector<float>& a_Data)
+    {
+        SF_INFO info;
+        memset(&info, 0, sizeof(SF_INFO));
+        info.samplerate = 48000;
+        info.channels   = 1;
+        info.format     = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+
+        SNDFILE* sf = sf_open(a_Name.c_str(), SFM_WRITE, &info);
+        if (sf == nullptr) {
+            m_Logger->error("Cannot write '{}'", a_Name);
+            return false;
+        }
+
+        sf_writef_float(sf, a_Data.data(), a_Data.size());
+        sf_close(sf);
+        return true;
+    };
+
+    // A constant lead-in, a sine loop and a loud tail past the loop end
+    const std::string loopFile = "micro_sampler_loop.wav";
+    std::vector<float> data (size);
+    for (size_t i=0; i<size; ++i) {
+        if (i < start) {
+            data[i] = 0.5f;
+        } else if (i < end) {
+            data[i] = (float)sin(omega * (double)(i - start));
+        } else {
+            data[i] = 1.0f;
+        }
+    }
+
+    if (!write(loopFile, data)) {
+        return -1;
+    }
+
+    // Silence followed by a loud tail
+    const std::string shotFile = "micro_sampler_shot.wav";
+    for (size_t i=0; i<size; ++i) {
+        data[i] = (i < start) ? 0.0f : 1.0f;
+    }
+
+    if (!write(shotFile, data)) {
+        std::remove(loopFile.c_str());
+        return -1;
+    }
+
+    auto loop = Sampler::get(loopFile, true, start, end);
+    auto shot = Sampler::get(shotFile, false);
+
+    std::remove(loopFile.c_str());
+    std::remove(shotFile.c_str());
+
+    // Plays a waveform from the beginning with a fractional step, calls the
+    // function with each position and output sample
+    auto play = [&](const Sampler& a_Sampler, size_t a_Level, size_t a_Count,
+                    std::function<void(double, float)> a_Check)
+    {
+        const size_t block = 256;
+        const double step  = 0.73;
+
+        std::vector<int32_t> index (block);
+        std::vector<float>   frac  (block);
+        std::vector<float>   out   (block);
+        std::vector<double>  where (block);
+
+        double pos = 0.0;
+        for (size_t n=0; n<a_Count; n+=block) {
+            for (size_t i=0; i<block; ++i) {
+                index[i] = (int32_t)pos;
+                frac [i] = (float)(pos - (double)index[i]);
+                where[i] = pos;
+                out  [i] = 1.0f;
+
+                pos += step;
+                if (a_Sampler.isLooped()) {
+                    while (pos >= (double)a_Sampler.getLoopEnd()) {
+                        pos -= (double)(a_Sampler.getLoopEnd() -
+                                        a_Sampler.getLoopStart());
+                    }
+                }
+            }
+
+            a_Sampler.render(a_Level, index.data(), frac.data(), out.data(),
+                             out.data(), block);
+
+            for (size_t i=0; i<block; ++i) {
+                a_Check(where[i], out[i]);
+            }
+        }
+    };
+
+    int failed = 0;
+
+    // Reports an accuracy check result
+    auto report = [&](const std::string& name, double error, double bound) {
+        bool pass = error <= bound;
+        if (pass) {
+            m_Logger->info ("{:<24} max. error {:.3e} (bound {:.1e}) OK",
+                name, error, bound);
+        } else {
+            m_Logger->error("{:<24} max. error {:.3e} (bound {:.1e}) FAIL",
+                name, error, bound);
+            failed++;
+        }
+    };
+
+    for (size_t level : {0, 3}) {
+        const std::string suffix = ", level " + std::to_string(level);
+
+        // Away from the lead-in the output follows the sine through the loop
+        // end and all later passes of the loop
+        double maxError = 0.0;
+        double last     = 0.0;
+        size_t wraps    = 0;
+
+        play(*loop, level, 20480, [&](double pos, float y) {
+            if (pos < last) {
+                wraps++;
+            }
+            last = pos;
+
+            if (wraps > 0 || pos >= (double)(start + 256)) {
+                double r = sin(omega * (pos - (double)start));
+                maxError = std::max(maxError, std::fabs((double)y - r));
+            }
+        });
+
+        if (wraps < 3) {
+            m_Logger->error("The loop wrapped {} times only", wraps);
+            failed++;
+        }
+
+        report("loop" + suffix, maxError, 2e-3);
+
+        // The attack of a one-shot waveform does not contain its tail
+        maxError = 0.0;
+        play(*shot, level, 1024, [&](double pos, float y) {
+            if (pos < (double)(start - 256)) {
+                maxError = std::max(maxError, std::fabs((double)y));
+            }
+        });
+
+        report("one-shot" + suffix, maxError, 1e-6);
+    }
+
+    return failed ? -1 : 0;
+}
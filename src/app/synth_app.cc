@@ -5,9 +5,6 @@
 #include <utils/logging.hh>
 #include <utils/exception.hh>
 
-#include <utils/element_tree.hh>
-#include <utils/xml2et.hh>
-
 #include <strutils.hh>
 #include <stringf.hh>
 
@@ -19,132 +16,22 @@
 
 #include <midi/alsaseq_autoconn.hh>
 
-#include <graph/builder.hh>
 #include <graph/exception.hh>
 
 #include <instrument/exception.hh>
 
-#ifdef SYNTH_USE_TBB
-#include <tbb/tbb.h>
-#endif
-
 #include <memory>
 #include <fstream>
 #include <queue>
 #include <algorithm>
 
 
-// ============================================================================
-
-Instrument::Instrument* SynthApp::createInstrument (Graph::Builder* a_Builder,
-                                                    const ElementTree::Node* a_Node)
-{
-    Instrument::Instrument::Attributes attributes;
-
-    // Get name
-    if (!a_Node->hasAttribute("name")) {
-        throw Instrument::BuildError("Instrument must have a name!");
-    }
-    const std::string name = a_Node->getAttribute("name");
-
-    // Get top-level module name
-    if (!a_Node->hasAttribute("module")) {
-        THROW(Instrument::BuildError,
-            "Instrument '%s' must have a top-level module type provided!",
-            name.c_str()
-        );
-    }
-    const std::string module = a_Node->getAttribute("module");
-
-    // TODO: Make attribute collection a function.
-    // Collect attributes from the "instrument" tag
-    for (auto& it : a_Node->getAttributes()) {
-        if (it.first == "name" || it.first == "module") {
-            continue;
-        }
-
-        attributes.set(it.first, it.second);
-    }
-
-    // Collect attributes from "attribute" tags
-    for (auto node : a_Node->findAll("attribute")) {
-        if (!node->hasAttribute("name")) {
-            throw Instrument::BuildError("An 'attribute' tag must have a 'name'!");
-        }
-        if (!node->hasAttribute("value")) {
-            throw Instrument::BuildError("An 'attribute' tag must have a 'value'!");
-        }
-
-        const std::string name  = node->getAttribute("name");
-        const std::string value = node->getAttribute("value");
-
-        if (attributes.has(name)) {
-            THROW(Instrument::BuildError, "Attribute '%s' redefined!", name.c_str());
-        }
-
-        attributes.set(name, value);
-    }
-
-    // Create the instrument
-    return new Instrument::Instrument(
-        name,
-        module,
-        a_Builder,
-        m_AudioSink->getSampleRate(),
-        m_AudioSink->getFramesPerBuffer(),
-        attributes
-    );
-}
-
 // ============================================================================
 
 void SynthApp::loadInstruments (const std::string& a_Config) {
 
-    auto logger = getLogger("app");
-    logger->info("Loading instruments from '{}'", a_Config);
-
-    // Load the config
-    auto root = xmlToElementTree(a_Config);
-    if (root == nullptr) {
-        THROW(std::runtime_error, "Error loading file '%s'", a_Config.c_str());
-    }
-
-    // Get sections
-    auto modules = root->find("modules");
-    if (modules == nullptr) {
-        throw Instrument::BuildError("No 'modules' section in the config file!");
-    }
-
-    auto instruments = root->find("instruments");
-    if (instruments == nullptr) {
-        throw Instrument::BuildError("No 'instruments' section in the config file!");
-    }
-
-    // Create graph builder
-    Graph::Builder builder;
-
-    builder.registerBuiltinModules();
-    builder.registerDefinedModules(modules.get());
-
-    // Create instruments
-    for (auto node : instruments->findAll("instrument")) {
-
-        // Create the instrument
-        auto instrument = std::shared_ptr<Instrument::Instrument>(
-            createInstrument(&builder, node.get()));
-
-        // Check the name
-        auto name = instrument->getName();
-        if (m_Instruments.has(name)) {
-            logger->error("Duplicate instrument name '{}'! Not adding.",
-                name
-            );
-            continue;
-        }
-
-        // Store
-        m_Instruments.set(name, instrument);
-    }
+    // Load instruments
+    m_Engine->loadInstruments(a_Config);
 
     // Store the config file name
     m_ConfigFiles.insert(a_Config);
@@ -152,11 +39,8 @@ void SynthApp::loadInstruments (const std::string& a_Config) {
 
 void SynthApp::deleteInstruments () {
 
-    auto logger = getLogger("app");
-    logger->info("Deleting all instruments");
-
     // Delete all instruments
-    m_Instruments.clear();
+    m_Engine->deleteInstruments();
 }
 
 void SynthApp::dumpInstruments () {
@@ -165,7 +49,7 @@ void SynthApp::dumpInstruments () {
     logger->info("Dumping instruments' graphs");
 
     // Dump graph for each instrument
-    for (auto& it : m_Instruments) {
+    for (auto& it : m_Engine->getInstruments()) {
         auto fileName = it.first + ".dot";
         logger->debug("{}: '{}'", it.first, fileName);
         it.second->dumpGraphAsDot(fileName);
@@ -177,7 +61,7 @@ void SynthApp::dumpInstruments () {
 void SynthApp::saveParameters (const std::string& a_FileName) {
     auto logger = getLogger("app");
 
-    for (auto& it : m_Instruments) {
+    for (auto& it : m_Engine->getInstruments()) {
         try {
             if (!a_FileName.empty()) {
                 it.second->saveParameters(a_FileName, true);
@@ -196,7 +80,7 @@ void SynthApp::saveParameters (const std::string& a_FileName) {
 void SynthApp::loadParameters (const std::string& a_FileName) {
     auto logger = getLogger("app");
 
-    for (auto& it : m_Instruments) {
+    for (auto& it : m_Engine->getInstruments()) {
         try {
             it.second->loadParameters(a_FileName);
         }
@@ -251,10 +135,15 @@ int SynthApp::run (int argc, const char* argv[]) {
         printf(" --device <device>      Audio device name\n");
         printf(" --sample-rate <rate>   Specify sample rate in Hz\n");
         printf(" --period <num samples> Specify audio buffer size in samples\n");
+        printf(" --quantum <samples>    Specify internal render quantum in samples (def. period)\n");
         printf(" --auto-connect         Automatically connect to MIDI input devices\n");
         printf(" --record               Start recording to a WAV file immediately\n");
         printf(" --dump-dot             Dump the instrument graph to a graphvis .dot file\n");
         printf(" --no-save-params       Do not save instrument parameters on exit\n");
+        printf(" --deterministic        Render bit-identical output regardless of thread count\n");
+        printf(" --seed <seed>          Random seed for the deterministic mode\n");
+        printf(" --max-voices <num>     Limit voices built across all instruments (def. no limit)\n");
+        printf(" --max-memory <MB>      Limit memory of voices built across all instruments (def. no limit)\n");
 
         return 1;
     }
@@ -335,6 +224,33 @@ int SynthApp::run (int argc, const char* argv[]) {
 
     // ........................................................................
 
+    // Create the synthesis engine. It renders in quanta that are assembled
+    // into device periods. A quantum that does not divide the period makes
+    // events near period ends late.
+    size_t framesPerBuffer = m_AudioSink->getFramesPerBuffer();
+    size_t quantum = argi(argc, argv, "--quantum", framesPerBuffer);
+    quantum = std::max<size_t>(1, std::min(quantum, framesPerBuffer));
+
+    if (framesPerBuffer % quantum) {
+        logger->warn("The render quantum {} does not divide the period {}",
+            quantum, framesPerBuffer);
+    }
+
+    logger->info("Render quantum: {}", quantum);
+    m_Engine.reset(new Engine::Engine(
+        m_AudioSink->getSampleRate(),
+        quantum
+    ));
+
+    if (argt(argc, argv, "--deterministic")) {
+        m_Engine->setDeterministic(true, argi(argc, argv, "--seed", 0));
+    }
+
+    m_Engine->setVoiceLimits(
+        argi(argc, argv, "--max-voices", 0),
+        (size_t)argi(argc, argv, "--max-memory", 0) * 1024 * 1024
+    );
+
     // Load instruments
     if (argt(argc, argv, "--instruments")) {
 
@@ -396,15 +312,13 @@ int SynthApp::run (int argc, const char* argv[]) {
     int64_t prevTime = 0;
 
     Audio::Buffer<float> masterMix (
-        m_AudioSink->getFramesPerBuffer(),
-        m_AudioSink->getChannels()
+        m_AudioSink->getFramesPerBuffer(), 2
     );
 
     size_t audioSize = masterMix.getSize() * masterMix.getChannels();
     std::unique_ptr<float> audioData(new float[audioSize]);
 
     std::queue<MIDI::Event> midiEvents;
-    std::vector<Instrument::Voice*> activeVoices;
 
     // Main loop
     logger->info("Running...");
@@ -428,8 +342,8 @@ int SynthApp::run (int argc, const char* argv[]) {
                 midiEvents.push(event);
             }
 
-            // Process MIDI events.
-            std::vector<MIDI::Event> midiEventsPeriod;
+            // Process MIDI events. The engine splits them at its render
+            // quantum boundaries.
             while (!midiEvents.empty()) {
                 auto& event = midiEvents.front();
 
@@ -451,7 +365,7 @@ int SynthApp::run (int argc, const char* argv[]) {
                     MIDI::Event newEvent = event;
                     newEvent.time = sampleTime;
 
-                    midiEventsPeriod.push_back(newEvent);
+                    m_Engine->pushEvent(newEvent);
                     midiEvents.pop();
                 }
                 
@@ -462,48 +376,17 @@ int SynthApp::run (int argc, const char* argv[]) {
                 }
             }
 
-            // Clear the active buffer
-            masterMix.clear();
-
-            // Build a list of all active voices
-            activeVoices.clear();
-            for (auto& it : m_Instruments) {
-                auto& instr = it.second;
-                instr->processEvents(midiEventsPeriod, activeVoices);
-            }
-
-            // Process voices
-#ifdef SYNTH_USE_TBB
-            tbb::parallel_for( tbb::blocked_range<size_t>(0, activeVoices.size()),
-                [=](const tbb::blocked_range<size_t>& r) {
-                    for (size_t i=r.begin(); i!=r.end(); ++i) {
-                        auto& voice = activeVoices[i];
-                        voice->process();
-                    }
-                }
-            );
-#else
-            for (auto& voice : activeVoices) {
-                voice->process();
-            }
-#endif
-
-            // Downmix
-            for (auto& voice : activeVoices) {
-                masterMix += voice->getBuffer();
-            }
+            // Render the period
+            m_Engine->render(masterMix.data(0), masterMix.data(1),
+                             masterMix.getSize());
 
             // Output stereo, interleave channels
             if (m_AudioSink->getChannels() == 2) {
-                size_t size = masterMix.getSize();
-                float* ptrL = masterMix.data(0);
-                float* ptrR = masterMix.data(1);
-                float* ptr  = audioData.get();
-
-                for (size_t i=0; i<size; ++i) {
-                    *ptr++ = *ptrL++;
-                    *ptr++ = *ptrR++;
-                }
+                Audio::Kernels::interleave(audioData.get(),
+                    masterMix.data(0),
+                    masterMix.data(1),
+                    masterMix.getSize()
+                );
 
                 m_AudioSink->writeBuffer(audioData.get());
             }
@@ -542,6 +425,12 @@ int SynthApp::run (int argc, const char* argv[]) {
     // Stop the socket server
     m_SocketServer->stop();
 
+    // Report voice pool statistics
+    const auto& stats = m_Engine->getVoiceStats();
+    logger->info("Voice pool: {} hits, {} misses, {} reclaims, {} refusals, {} peak voices, {:.3f}ms building",
+        stats.hits, stats.misses, stats.reclaims, stats.refusals,
+        stats.peakVoices, stats.buildTime * 1e3);
+
     // Save all instrument's parameters
     if (!argt(argc, argv, "--no-save-params")) {
         saveParameters();
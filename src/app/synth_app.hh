@@ -12,6 +12,8 @@
 
 #include <instrument/instrument.hh>
 
+#include <engine/engine.hh>
+
 #include <iface/socket_server.hh>
 
 #include <memory>
@@ -27,10 +29,6 @@ public:
 
 protected:
 
-    /// Creates a single instrument
-    Instrument::Instrument* createInstrument (Graph::Builder* a_Builder,
-                                              const ElementTree::Node* a_Node);
-
     /// Loads instruments
     void loadInstruments   (const std::string& a_Config);
     /// Reloads instruments
@@ -80,8 +78,8 @@ protected:
     /// MIDI source
     std::unique_ptr<MIDI::AlsaSeqSource>  m_MidiSource;
 
-    /// Instruments
-    Dict<std::string, std::shared_ptr<Instrument::Instrument>> m_Instruments;
+    /// Synthesis engine
+    std::unique_ptr<Engine::Engine> m_Engine;
     /// Loaded config files
     std::unordered_set<std::string> m_ConfigFiles;
 
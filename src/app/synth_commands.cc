@@ -135,14 +135,14 @@ std::vector<std::string> SynthApp::cmdListParams (const std::vector<std::string>
 
     // Sorted instrument name list
     std::vector<std::string> instrumentNames;
-    for (auto& it : m_Instruments) {
+    for (auto& it : m_Engine->getInstruments()) {
         instrumentNames.push_back(it.first);
     }
     std::sort(instrumentNames.begin(), instrumentNames.end());
 
     // For each syntesizer
     for (auto& instrumentName : instrumentNames) {
-        auto& instr  = m_Instruments.get(instrumentName);
+        auto& instr  = m_Engine->getInstruments().get(instrumentName);
         auto& params = instr->getParameters();
 
         // Sorted parameter name list
@@ -204,12 +204,12 @@ std::vector<std::string> SynthApp::cmdSetParam (const std::vector<std::string>&
         return response;
     }
 
-    if (!m_Instruments.has(fields[0])) {
+    if (!m_Engine->getInstruments().has(fields[0])) {
         response.push_back(stringf("ERR:No instrument '%s'", fields[0].c_str()));
         return response;
     }
 
-    auto& instrument = m_Instruments.get(fields[0]);
+    auto& instrument = m_Engine->getInstruments().get(fields[0]);
 
     // Get the value
     Dict<std::string, Graph::Parameter::Value> params;
@@ -250,12 +250,12 @@ std::vector<std::string> SynthApp::cmdGetParam (const std::vector<std::string>&
         return response;
     }
 
-    if (!m_Instruments.has(fields[0])) {
+    if (!m_Engine->getInstruments().has(fields[0])) {
         response.push_back(stringf("ERR:No instrument '%s'", fields[0].c_str()));
         return response;
     }
 
-    auto& instrument = m_Instruments.get(fields[0]);
+    auto& instrument = m_Engine->getInstruments().get(fields[0]);
 
     // Get the parameter
     auto& params = instrument->getParameters();
@@ -334,7 +334,7 @@ std::vector<std::string> SynthApp::cmdResetParams (const std::vector<std::string
     }
 
     // For each instrument
-    for (auto& itr : m_Instruments) {
+    for (auto& itr : m_Engine->getInstruments()) {
         auto& instr  = itr.second;
         auto& params = instr->getParameters();
 
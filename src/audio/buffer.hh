@@ -2,52 +2,119 @@
 #define AUDIO_BUFFER_HH
 
 #include "exception.hh"
+#include "kernels.hh"
 
 #include <memory>
+#include <new>
 
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
 
 namespace Audio {
 
 // ============================================================================
 
+/// A non-owning view of a multi-channel audio buffer. Cheap to copy, does not
+/// touch any reference counts. Valid as long as the viewed buffer exists.
+template <typename T>
+class BufferView {
+public:
+
+    /// Constructor
+    BufferView (T* a_Data = nullptr, size_t a_Size = 0,
+                size_t a_Channels = 1, size_t a_Stride = 0) :
+        m_Data      (a_Data),
+        m_Size      (a_Size),
+        m_Channels  (a_Channels),
+        m_Stride    (a_Stride ? a_Stride : a_Size)
+    {}
+
+    /// Returns size
+    inline size_t getSize () const {
+        return m_Size;
+    }
+
+    /// Returns channel count
+    inline size_t getChannels () const {
+        return m_Channels;
+    }
+
+    /// Returns distance between channels (in samples)
+    inline size_t getStride () const {
+        return m_Stride;
+    }
+
+    /// Returns a pointer to the channel data
+    inline T* data (size_t a_Channel = 0) const {
+        return m_Data + (m_Stride * a_Channel);
+    }
+
+protected:
+
+    /// Data
+    T*      m_Data;
+    /// Size (in frames)
+    size_t  m_Size;
+    /// Number of channels
+    size_t  m_Channels;
+    /// Channel stride (in samples)
+    size_t  m_Stride;
+};
+
+// ============================================================================
+
 /// A generic multi-channel audio buffer. Supports basic arithmetic operations.
+/// The data is aligned to Kernels::ALIGNMENT bytes. Each channel is padded to
+/// a multiple of the alignment so that every channel starts aligned as well.
 template <typename T>
 class Buffer {
+    static_assert(Kernels::ALIGNMENT % sizeof(T) == 0,
+        "Sample size must divide the buffer alignment");
+
 public:
 
     /// Constructor
-    Buffer (size_t a_Size = 0, size_t a_Channels = 1) : 
+    Buffer (size_t a_Size = 0, size_t a_Channels = 1) :
         m_Size      (0),
-        m_Channels  (1)
+        m_Channels  (1),
+        m_Stride    (0)
     {
-        assert(m_Channels >= 1);
+        assert(a_Channels >= 1);
         create(a_Size, a_Channels);
     }
 
-    /// Copy constructor
+    /// Copy constructor. Shares the data with the other buffer
     Buffer (const Buffer& ref) :
         m_Size      (ref.m_Size),
         m_Channels  (ref.m_Channels),
+        m_Stride    (ref.m_Stride),
         m_Data      (ref.m_Data)
     {}
 
     // ........................................................................
 
-    /// Creates the buffer
+    /// Creates the buffer. The content is zeroed.
     void create (size_t a_Size, size_t a_Channels = 1) {
-        assert(m_Channels >= 1);
+        assert(a_Channels >= 1);
 
         if (a_Size != m_Size || a_Channels != m_Channels) {
             m_Size     = a_Size;
             m_Channels = a_Channels;
+            m_Stride   = padSize(a_Size);
 
             if (m_Size != 0) {
-                size_t count = a_Size * a_Channels;
-                m_Data.reset(new T[count]);
+                size_t bytes = m_Stride * m_Channels * sizeof(T);
+                void*  ptr   = nullptr;
+
+                if (posix_memalign(&ptr, Kernels::ALIGNMENT, bytes) != 0) {
+                    throw std::bad_alloc();
+                }
+
+                memset(ptr, 0, bytes);
+                m_Data.reset((T*)ptr, free);
             }
             else {
                 m_Data.reset();
@@ -58,15 +125,17 @@ public:
     /// Releases the buffer
     void release () {
         m_Size     = 0;
+        m_Stride   = 0;
         m_Data.reset();
     }
 
     // ........................................................................
 
-    /// Assignment
+    /// Assignment. Shares the data with the other buffer
     void operator = (const Buffer<T>& ref) {
         m_Size     = ref.m_Size;
         m_Channels = ref.m_Channels;
+        m_Stride   = ref.m_Stride;
         m_Data     = ref.m_Data;
     }
 
@@ -83,11 +152,30 @@ public:
         check(ref);
 
         if (m_Size) {
-            size_t count = m_Size * m_Channels;       
-            memcpy(ref.m_Data.get(), m_Data.get(), sizeof(T) * count);
+            memcpy(ref.m_Data.get(), m_Data.get(), sizeof(T) * getCount());
         }
     }
 
+    /// Returns a non-owning view
+    BufferView<T> view () {
+        return BufferView<T>(m_Data.get(), m_Size, m_Channels, m_Stride);
+    }
+
+    /// Returns a non-owning constant view
+    BufferView<const T> view () const {
+        return BufferView<const T>(m_Data.get(), m_Size, m_Channels, m_Stride);
+    }
+
+    /// Implicit conversion to a view
+    operator BufferView<T> () {
+        return view();
+    }
+
+    /// Implicit conversion to a constant view
+    operator BufferView<const T> () const {
+        return view();
+    }
+
     // ........................................................................
 
     /// Returns size
@@ -100,16 +188,21 @@ public:
         return m_Channels;
     }
 
+    /// Returns distance between channels (in samples)
+    inline size_t getStride () const {
+        return m_Stride;
+    }
+
     /// Returns a pointer to the channel data
     inline T* data (size_t a_Channel = 0) {
         T* ptr = m_Data.get();
-        return ptr + (m_Size * a_Channel);
+        return ptr + (m_Stride * a_Channel);
     }
 
     /// Returns a constant pointer to the channel data
     inline const T* data (size_t a_Channel = 0) const {
         const T* ptr = m_Data.get();
-        return ptr + (m_Size * a_Channel);
+        return ptr + (m_Stride * a_Channel);
     }
 
     /// Checks compatibility of two buffers
@@ -122,89 +215,31 @@ public:
     /// Clears the buffer
     void clear () {
         if (m_Size) {
-            size_t count = m_Size * m_Channels;
-            memset(m_Data.get(), 0, count * sizeof(T));
+            memset(m_Data.get(), 0, getCount() * sizeof(T));
         }
     }
 
     /// Fills the buffer with the given value
     void fill (T val) {
-        size_t count = m_Size * m_Channels;
-        T*     ptr   = m_Data.get();
-        size_t i;
-
-        for (i=0; i<(count-4); i=i+4) {
-            *ptr++ = val;
-            *ptr++ = val;
-            *ptr++ = val;
-            *ptr++ = val;
-        }
-
-        for (; i<count; ++i) {
-            *ptr++ = val;
-        }
+        Kernels::fill(m_Data.get(), val, getCount());
     }
 
     // ........................................................................
 
-    Buffer<T> operator *= (T k) {
-        size_t count = m_Size * m_Channels;
-        T*     ptr   = m_Data.get();
-        size_t i;
-
-        for (i=0; i<(count-4); i=i+4) {
-            *ptr++ *= k;
-            *ptr++ *= k;
-            *ptr++ *= k;
-            *ptr++ *= k;
-        }
-
-        for (; i<count; ++i) {
-            *ptr++ *= k;
-        }
+    Buffer<T>& operator *= (T k) {
+        Kernels::scale(m_Data.get(), k, getCount());
+        return *this;
     }
 
-    Buffer<T> operator += (const Buffer<T>& ref) {
+    Buffer<T>& operator += (const Buffer<T>& ref) {
         check(ref);
-
-        size_t count = m_Size * m_Channels;
-        T*     dst   = m_Data.get();
-        T*     src   = ref.m_Data.get();
-        size_t i;
-
-        for (i=0; i<(count-4); i=i+4) {
-            *dst++ += *src++;
-            *dst++ += *src++;
-            *dst++ += *src++;
-            *dst++ += *src++;
-        }
-
-        for (; i<count; ++i) {
-            *dst++ += *src++;
-        }
-
+        Kernels::add(m_Data.get(), ref.m_Data.get(), getCount());
         return *this;
     }
 
-    Buffer<T> operator *= (const Buffer<T>& ref) {
+    Buffer<T>& operator *= (const Buffer<T>& ref) {
         check(ref);
-
-        size_t count = m_Size * m_Channels;
-        T*     dst   = m_Data.get();
-        T*     src   = ref.m_Data.get();
-        size_t i;
-
-        for (i=0; i<(count-4); i=i+4) {
-            *dst++ *= *src++;
-            *dst++ *= *src++;
-            *dst++ *= *src++;
-            *dst++ *= *src++;
-        }
-
-        for (; i<count; ++i) {
-            *dst++ *= *src++;
-        }
-
+        Kernels::mul(m_Data.get(), ref.m_Data.get(), getCount());
         return *this;
     }
 
@@ -212,6 +247,19 @@ public:
 
 protected:
 
+    /// Rounds the size up to a multiple of the alignment
+    static inline size_t padSize (size_t a_Size) {
+        const size_t n = Kernels::ALIGNMENT / sizeof(T);
+        return ((a_Size + n - 1) / n) * n;
+    }
+
+    /// Returns the total sample count including padding. Padding is never
+    /// read as audio so operating on it is harmless and keeps kernel loops
+    /// free of per-channel tails.
+    inline size_t getCount () const {
+        return m_Stride * m_Channels;
+    }
+
     /// Throws an exception if buffers are not compatible
     inline void check (const Buffer<T>& other) const {
 
@@ -232,6 +280,8 @@ protected:
     size_t  m_Size;
     /// Number of channels
     size_t  m_Channels;
+    /// Channel stride (in samples)
+    size_t  m_Stride;
 
     /// Data
     std::shared_ptr<T> m_Data;
@@ -242,4 +292,3 @@ protected:
 }; // Audio
 
 #endif // AUDIO_BUFFER_HH
-
@@ -0,0 +1,433 @@
+#include "kernels.hh"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+#include <cmath>
+
+namespace Audio {
+namespace Kernels {
+
+// ============================================================================
+
+namespace {
+
+/// Kernel implementation table
+struct Table {
+    const char* name;
+
+    void  (*fill)       (float*, float, size_t);
+    void  (*add)        (float*, const float*, size_t);
+    void  (*mul)        (float*, const float*, size_t);
+    void  (*mac)        (float*, const float*, float, size_t);
+    void  (*scale)      (float*, float, size_t);
+    float (*peak)       (const float*, size_t);
+    void  (*interleave) (float*, const float*, const float*, size_t);
+};
+
+// ============================================================================
+// Scalar
+
+void fillScalar (float* dst, float val, size_t count) {
+    for (size_t i=0; i<count; ++i) dst[i] = val;
+}
+
+void addScalar (float* dst, const float* src, size_t count) {
+    for (size_t i=0; i<count; ++i) dst[i] += src[i];
+}
+
+void mulScalar (float* dst, const float* src, size_t count) {
+    for (size_t i=0; i<count; ++i) dst[i] *= src[i];
+}
+
+void macScalar (float* dst, const float* src, float k, size_t count) {
+    for (size_t i=0; i<count; ++i) dst[i] += src[i] * k;
+}
+
+void scaleScalar (float* dst, float k, size_t count) {
+    for (size_t i=0; i<count; ++i) dst[i] *= k;
+}
+
+float peakScalar (const float* src, size_t count) {
+    float peak = 0.0f;
+    for (size_t i=0; i<count; ++i) {
+        float mag = fabsf(src[i]);
+        if (mag > peak) peak = mag;
+    }
+    return peak;
+}
+
+void interleaveScalar (float* dst, const float* l, const float* r, size_t count) {
+    for (size_t i=0; i<count; ++i) {
+        *dst++ = l[i];
+        *dst++ = r[i];
+    }
+}
+
+const Table g_Scalar = {
+    "scalar",
+    fillScalar, addScalar, mulScalar, macScalar, scaleScalar, peakScalar,
+    interleaveScalar
+};
+
+// ============================================================================
+// SSE
+
+#ifdef KERNELS_X86
+
+__attribute__((target("sse2")))
+void fillSse (float* dst, float val, size_t count) {
+    __m128 v = _mm_set1_ps(val);
+    size_t i = 0;
+    for (; i+4<=count; i+=4) _mm_storeu_ps(dst + i, v);
+    for (; i<count; ++i) dst[i] = val;
+}
+
+__attribute__((target("sse2")))
+void addSse (float* dst, const float* src, size_t count) {
+    size_t i = 0;
+    for (; i+4<=count; i+=4) {
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i)));
+    }
+    for (; i<count; ++i) dst[i] += src[i];
+}
+
+__attribute__((target("sse2")))
+void mulSse (float* dst, const float* src, size_t count) {
+    size_t i = 0;
+    for (; i+4<=count; i+=4) {
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i)));
+    }
+    for (; i<count; ++i) dst[i] *= src[i];
+}
+
+__attribute__((target("sse2")))
+void macSse (float* dst, const float* src, float k, size_t count) {
+    __m128 vk = _mm_set1_ps(k);
+    size_t i  = 0;
+    for (; i+4<=count; i+=4) {
+        __m128 p = _mm_mul_ps(_mm_loadu_ps(src + i), vk);
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), p));
+    }
+    for (; i<count; ++i) dst[i] += src[i] * k;
+}
+
+__attribute__((target("sse2")))
+void scaleSse (float* dst, float k, size_t count) {
+    __m128 vk = _mm_set1_ps(k);
+    size_t i  = 0;
+    for (; i+4<=count; i+=4) {
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(dst + i), vk));
+    }
+    for (; i<count; ++i) dst[i] *= k;
+}
+
+__attribute__((target("sse2")))
+float peakSse (const float* src, size_t count) {
+    const __m128 mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 vmax = _mm_setzero_ps();
+    size_t i    = 0;
+    for (; i+4<=count; i+=4) {
+        vmax = _mm_max_ps(vmax, _mm_and_ps(_mm_loadu_ps(src + i), mask));
+    }
+
+    float tmp[4];
+    _mm_storeu_ps(tmp, vmax);
+    float peak = fmaxf(fmaxf(tmp[0], tmp[1]), fmaxf(tmp[2], tmp[3]));
+
+    for (; i<count; ++i) {
+        float mag = fabsf(src[i]);
+        if (mag > peak) peak = mag;
+    }
+    return peak;
+}
+
+__attribute__((target("sse2")))
+void interleaveSse (float* dst, const float* l, const float* r, size_t count) {
+    size_t i = 0;
+    for (; i+4<=count; i+=4) {
+        __m128 vl = _mm_loadu_ps(l + i);
+        __m128 vr = _mm_loadu_ps(r + i);
+        _mm_storeu_ps(dst + 2*i,     _mm_unpacklo_ps(vl, vr));
+        _mm_storeu_ps(dst + 2*i + 4, _mm_unpackhi_ps(vl, vr));
+    }
+    for (; i<count; ++i) {
+        dst[2*i]     = l[i];
+        dst[2*i + 1] = r[i];
+    }
+}
+
+const Table g_Sse = {
+    "sse2",
+    fillSse, addSse, mulSse, macSse, scaleSse, peakSse, interleaveSse
+};
+
+// ============================================================================
+// AVX2. Multiply-accumulate is not fused so that the output matches the
+// other implementations bit for bit.
+
+__attribute__((target("avx2")))
+void fillAvx2 (float* dst, float val, size_t count) {
+    __m256 v = _mm256_set1_ps(val);
+    size_t i = 0;
+    for (; i+8<=count; i+=8) _mm256_storeu_ps(dst + i, v);
+    for (; i<count; ++i) dst[i] = val;
+}
+
+__attribute__((target("avx2")))
+void addAvx2 (float* dst, const float* src, size_t count) {
+    size_t i = 0;
+    for (; i+8<=count; i+=8) {
+        _mm256_storeu_ps(dst + i,
+            _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_loadu_ps(src + i)));
+    }
+    for (; i<count; ++i) dst[i] += src[i];
+}
+
+__attribute__((target("avx2")))
+void mulAvx2 (float* dst, const float* src, size_t count) {
+    size_t i = 0;
+    for (; i+8<=count; i+=8) {
+        _mm256_storeu_ps(dst + i,
+            _mm256_mul_ps(_mm256_loadu_ps(dst + i), _mm256_loadu_ps(src + i)));
+    }
+    for (; i<count; ++i) dst[i] *= src[i];
+}
+
+__attribute__((target("avx2")))
+void macAvx2 (float* dst, const float* src, float k, size_t count) {
+    __m256 vk = _mm256_set1_ps(k);
+    size_t i  = 0;
+    for (; i+8<=count; i+=8) {
+        __m256 p = _mm256_mul_ps(_mm256_loadu_ps(src + i), vk);
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), p));
+    }
+    for (; i<count; ++i) dst[i] += src[i] * k;
+}
+
+__attribute__((target("avx2")))
+void scaleAvx2 (float* dst, float k, size_t count) {
+    __m256 vk = _mm256_set1_ps(k);
+    size_t i  = 0;
+    for (; i+8<=count; i+=8) {
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(dst + i), vk));
+    }
+    for (; i<count; ++i) dst[i] *= k;
+}
+
+__attribute__((target("avx2")))
+float peakAvx2 (const float* src, size_t count) {
+    const __m256 mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    __m256 vmax = _mm256_setzero_ps();
+    size_t i    = 0;
+    for (; i+8<=count; i+=8) {
+        vmax = _mm256_max_ps(vmax, _mm256_and_ps(_mm256_loadu_ps(src + i), mask));
+    }
+
+    __m128 vmax4 = _mm_max_ps(_mm256_castps256_ps128(vmax),
+                              _mm256_extractf128_ps(vmax, 1));
+    float tmp[4];
+    _mm_storeu_ps(tmp, vmax4);
+    float peak = fmaxf(fmaxf(tmp[0], tmp[1]), fmaxf(tmp[2], tmp[3]));
+
+    for (; i<count; ++i) {
+        float mag = fabsf(src[i]);
+        if (mag > peak) peak = mag;
+    }
+    return peak;
+}
+
+__attribute__((target("avx2")))
+void interleaveAvx2 (float* dst, const float* l, const float* r, size_t count) {
+    size_t i = 0;
+    for (; i+8<=count; i+=8) {
+        __m256 vl = _mm256_loadu_ps(l + i);
+        __m256 vr = _mm256_loadu_ps(r + i);
+        __m256 lo = _mm256_unpacklo_ps(vl, vr); // l0 r0 l1 r1 | l4 r4 l5 r5
+        __m256 hi = _mm256_unpackhi_ps(vl, vr); // l2 r2 l3 r3 | l6 r6 l7 r7
+        _mm256_storeu_ps(dst + 2*i,     _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(dst + 2*i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+    for (; i<count; ++i) {
+        dst[2*i]     = l[i];
+        dst[2*i + 1] = r[i];
+    }
+}
+
+const Table g_Avx2 = {
+    "avx2",
+    fillAvx2, addAvx2, mulAvx2, macAvx2, scaleAvx2, peakAvx2, interleaveAvx2
+};
+
+#endif // KERNELS_X86
+
+// ============================================================================
+// NEON
+
+#ifdef KERNELS_NEON
+
+void fillNeon (float* dst, float val, size_t count) {
+    float32x4_t v = vdupq_n_f32(val);
+    size_t i = 0;
+    for (; i+4<=count; i+=4) vst1q_f32(dst + i, v);
+    for (; i<count; ++i) dst[i] = val;
+}
+
+void addNeon (float* dst, const float* src, size_t count) {
+    size_t i = 0;
+    for (; i+4<=count; i+=4) {
+        vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), vld1q_f32(src + i)));
+    }
+    for (; i<count; ++i) dst[i] += src[i];
+}
+
+void mulNeon (float* dst, const float* src, size_t count) {
+    size_t i = 0;
+    for (; i+4<=count; i+=4) {
+        vst1q_f32(dst + i, vmulq_f32(vld1q_f32(dst + i), vld1q_f32(src + i)));
+    }
+    for (; i<count; ++i) dst[i] *= src[i];
+}
+
+void macNeon (float* dst, const float* src, float k, size_t count) {
+    size_t i = 0;
+    for (; i+4<=count; i+=4) {
+        vst1q_f32(dst + i, vmlaq_n_f32(vld1q_f32(dst + i), vld1q_f32(src + i), k));
+    }
+    for (; i<count; ++i) dst[i] += src[i] * k;
+}
+
+void scaleNeon (float* dst, float k, size_t count) {
+    size_t i = 0;
+    for (; i+4<=count; i+=4) {
+        vst1q_f32(dst + i, vmulq_n_f32(vld1q_f32(dst + i), k));
+    }
+    for (; i<count; ++i) dst[i] *= k;
+}
+
+float peakNeon (const float* src, size_t count) {
+    float32x4_t vmax = vdupq_n_f32(0.0f);
+    size_t i = 0;
+    for (; i+4<=count; i+=4) {
+        vmax = vmaxq_f32(vmax, vabsq_f32(vld1q_f32(src + i)));
+    }
+
+    float32x2_t vmax2 = vpmax_f32(vget_low_f32(vmax), vget_high_f32(vmax));
+    vmax2 = vpmax_f32(vmax2, vmax2);
+    float peak = vget_lane_f32(vmax2, 0);
+
+    for (; i<count; ++i) {
+        float mag = fabsf(src[i]);
+        if (mag > peak) peak = mag;
+    }
+    return peak;
+}
+
+void interleaveNeon (float* dst, const float* l, const float* r, size_t count) {
+    size_t i = 0;
+    for (; i+4<=count; i+=4) {
+        float32x4x2_t v;
+        v.val[0] = vld1q_f32(l + i);
+        v.val[1] = vld1q_f32(r + i);
+        vst2q_f32(dst + 2*i, v);
+    }
+    for (; i<count; ++i) {
+        dst[2*i]     = l[i];
+        dst[2*i + 1] = r[i];
+    }
+}
+
+const Table g_Neon = {
+    "neon",
+    fillNeon, addNeon, mulNeon, macNeon, scaleNeon, peakNeon, interleaveNeon
+};
+
+#endif // KERNELS_NEON
+
+// ============================================================================
+
+/// Selects the best implementation supported by the CPU
+const Table& selectTable () {
+
+#ifdef KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return g_Avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return g_Sse;
+    }
+#endif
+
+#ifdef KERNELS_NEON
+    return g_Neon;
+#endif
+
+    return g_Scalar;
+}
+
+/// Returns the selected implementation. Selected once on first use.
+inline const Table& getTable () {
+    static const Table& table = selectTable();
+    return table;
+}
+
+}; // Anonymous
+
+// ============================================================================
+
+const char* getImplementation () {
+    return getTable().name;
+}
+
+void fill (float* dst, float val, size_t count) {
+    getTable().fill(dst, val, count);
+}
+
+void add (float* dst, const float* src, size_t count) {
+    getTable().add(dst, src, count);
+}
+
+void mul (float* dst, const float* src, size_t count) {
+    getTable().mul(dst, src, count);
+}
+
+void mac (float* dst, const float* src, float k, size_t count) {
+    getTable().mac(dst, src, k, count);
+}
+
+void scale (float* dst, float k, size_t count) {
+    getTable().scale(dst, k, count);
+}
+
+float peak (const float* src, size_t count) {
+    return getTable().peak(src, count);
+}
+
+void interleave (float* dst, const float* l, const float* r, size_t count) {
+    getTable().interleave(dst, l, r, count);
+}
+
+// ============================================================================
+
+template <size_t N>
+void fixedMac (float* dst, const float* src, float k) {
+    for (size_t i=0; i<N; ++i) dst[i] += src[i] * k;
+}
+
+template void fixedMac<32>  (float*, const float*, float);
+template void fixedMac<64>  (float*, const float*, float);
+template void fixedMac<128> (float*, const float*, float);
+template void fixedMac<256> (float*, const float*, float);
+
+// ============================================================================
+
+}; // Kernels
+}; // Audio
@@ -0,0 +1,126 @@
+#ifndef AUDIO_KERNELS_HH
+#define AUDIO_KERNELS_HH
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Audio {
+namespace Kernels {
+
+// ============================================================================
+
+/// Alignment of audio buffer allocations in bytes. Covers a full cache line
+/// and the widest vector register in use.
+constexpr size_t ALIGNMENT = 64;
+
+/// Returns the name of the selected kernel implementation
+const char* getImplementation ();
+
+// ============================================================================
+
+/// Sets count samples of dst to val
+void  fill  (float* dst, float val, size_t count);
+/// dst[i] += src[i]
+void  add   (float* dst, const float* src, size_t count);
+/// dst[i] *= src[i]
+void  mul   (float* dst, const float* src, size_t count);
+/// dst[i] += src[i] * k (multiply-accumulate, rounded after the multiply
+/// in every implementation)
+void  mac   (float* dst, const float* src, float k, size_t count);
+/// dst[i] *= k
+void  scale (float* dst, float k, size_t count);
+/// Returns max(|src[i]|)
+float peak  (const float* src, size_t count);
+/// Interleaves two channels, dst[2*i] = l[i], dst[2*i+1] = r[i]
+void  interleave (float* dst, const float* l, const float* r, size_t count);
+
+/// dst[i] += src[i] * k for a block length known at compile time. Defined in
+/// kernels.cc, which is built without fused multiply-adds, for N of 32, 64,
+/// 128 and 256 so that it rounds exactly like mac().
+template <size_t N>
+void  fixedMac (float* dst, const float* src, float k);
+
+// ============================================================================
+
+/// Kernels for a block length known at compile time. The loops have constant
+/// trip counts so the compiler can fully unroll and vectorize them for the
+/// target. The count argument is ignored. N of 0 selects the runtime length
+/// kernels above.
+template <size_t N>
+struct Fixed {
+
+    static inline void fill (float* dst, float val, size_t) {
+        for (size_t i=0; i<N; ++i) dst[i] = val;
+    }
+
+    static inline void add (float* dst, const float* src, size_t) {
+        for (size_t i=0; i<N; ++i) dst[i] += src[i];
+    }
+
+    static inline void mul (float* dst, const float* src, size_t) {
+        for (size_t i=0; i<N; ++i) dst[i] *= src[i];
+    }
+
+    static inline void mac (float* dst, const float* src, float k, size_t) {
+        fixedMac<N>(dst, src, k);
+    }
+
+    static inline void scale (float* dst, float k, size_t) {
+        for (size_t i=0; i<N; ++i) dst[i] *= k;
+    }
+};
+
+template <>
+struct Fixed<0> {
+
+    static inline void fill (float* dst, float val, size_t count) {
+        Kernels::fill(dst, val, count);
+    }
+
+    static inline void add (float* dst, const float* src, size_t count) {
+        Kernels::add(dst, src, count);
+    }
+
+    static inline void mul (float* dst, const float* src, size_t count) {
+        Kernels::mul(dst, src, count);
+    }
+
+    static inline void mac (float* dst, const float* src, float k, size_t count) {
+        Kernels::mac(dst, src, k, count);
+    }
+
+    static inline void scale (float* dst, float k, size_t count) {
+        Kernels::scale(dst, k, count);
+    }
+};
+
+// ============================================================================
+
+/// Generic fallbacks for non-float sample types
+
+template <typename T>
+void fill (T* dst, T val, size_t count) {
+    for (size_t i=0; i<count; ++i) dst[i] = val;
+}
+
+template <typename T>
+void add (T* dst, const T* src, size_t count) {
+    for (size_t i=0; i<count; ++i) dst[i] += src[i];
+}
+
+template <typename T>
+void mul (T* dst, const T* src, size_t count) {
+    for (size_t i=0; i<count; ++i) dst[i] *= src[i];
+}
+
+template <typename T>
+void scale (T* dst, T k, size_t count) {
+    for (size_t i=0; i<count; ++i) dst[i] *= k;
+}
+
+// ============================================================================
+
+}; // Kernels
+}; // Audio
+
+#endif // AUDIO_KERNELS_HH
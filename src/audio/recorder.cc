@@ -153,14 +153,11 @@ void Recorder::popAndWrite () {
     m_AudioData.resize(count);
 
     if (buffer.getChannels() == 2) {
-        const float* ptrL = buffer.data(0);
-        const float* ptrR = buffer.data(1);
-        float*       ptr  = m_AudioData.data();
-        
-        for (size_t i=0; i<count; i=i+2) {
-            *ptr++ = *ptrL++;
-            *ptr++ = *ptrR++;
-        }
+        Kernels::interleave(m_AudioData.data(),
+            buffer.data(0),
+            buffer.data(1),
+            buffer.getSize()
+        );
     }
     else if (buffer.getChannels() == 1) {
         memcpy(m_AudioData.data(), buffer.data(), count * sizeof(float));
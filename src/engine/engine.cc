@@ -0,0 +1,381 @@
+#include "engine.hh"
+
+#include <utils/utils.hh>
+#include <utils/logging.hh>
+#include <utils/exception.hh>
+#include <stringf.hh>
+
+#ifdef SYNTH_USE_TBB
+#include <tbb/tbb.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+namespace Engine {
+
+// ============================================================================
+
+Engine::Engine (size_t a_SampleRate, size_t a_BufferSize) :
+    m_SampleRate (a_SampleRate),
+    m_BufferSize (a_BufferSize),
+#ifdef SYNTH_USE_TBB
+    m_Buses      ([a_BufferSize]() {
+                    Audio::Buffer<float> bus(a_BufferSize, 2);
+                    bus.clear();
+                    return bus;
+                 }),
+#endif
+    m_Buffer     (a_BufferSize, 2),
+    m_BufferPos  (a_BufferSize)
+{
+    // Get the logger
+    m_Logger = getLogger("engine");
+}
+
+// ============================================================================
+
+size_t Engine::getSampleRate () const {
+    return m_SampleRate;
+}
+
+size_t Engine::getBufferSize () const {
+    return m_BufferSize;
+}
+
+// ============================================================================
+
+void Engine::loadInstruments (const std::string& a_Config) {
+    m_Logger->info("Loading instruments from '{}'", a_Config);
+
+    // Load
+    auto instruments = Instrument::loadInstruments(
+        a_Config,
+        m_SampleRate,
+        m_BufferSize,
+        &m_VoicePool
+    );
+
+    // Store
+    for (auto& it : instruments) {
+
+        // Check the name
+        if (m_Instruments.has(it.first)) {
+            m_Logger->error("Duplicate instrument name '{}'! Not adding.",
+                it.first
+            );
+            continue;
+        }
+
+        m_Instruments.set(it.first, it.second);
+
+        if (m_Deterministic) {
+            seedInstrument(it.second.get());
+        }
+    }
+
+    updateInstrumentOrder();
+}
+
+void Engine::deleteInstruments () {
+    m_Logger->info("Deleting all instruments");
+
+    // Delete all instruments
+    m_ActiveVoices.clear();
+    m_Instruments.clear();
+
+    updateInstrumentOrder();
+}
+
+Instrument::Instruments& Engine::getInstruments () {
+    return m_Instruments;
+}
+
+void Engine::setVoiceLimits (size_t a_MaxVoices, size_t a_MaxMemory) {
+    m_VoicePool.setLimits(a_MaxVoices, a_MaxMemory);
+}
+
+const Instrument::VoicePool::Stats& Engine::getVoiceStats () const {
+    return m_VoicePool.getStats();
+}
+
+void Engine::updateInstrumentOrder () {
+
+    m_InstrumentOrder.clear();
+    for (auto& it : m_Instruments) {
+        m_InstrumentOrder.push_back(it.second.get());
+    }
+
+    std::sort(m_InstrumentOrder.begin(), m_InstrumentOrder.end(),
+        [](Instrument::Instrument* a, Instrument::Instrument* b) {
+            return a->getName() < b->getName();
+        });
+
+    m_Router.build(m_InstrumentOrder);
+}
+
+// ============================================================================
+
+void Engine::setDeterministic (bool a_Enable, uint32_t a_Seed) {
+    m_Deterministic = a_Enable;
+    m_Seed          = a_Seed;
+
+    // Voices built in the background become available at times that depend
+    // on the machine load, build them synchronously instead.
+    m_VoicePool.setBackgroundBuilds(!a_Enable);
+
+    if (m_Deterministic) {
+        m_Logger->info("Deterministic mode enabled, seed {}", m_Seed);
+        for (auto instrument : m_InstrumentOrder) {
+            seedInstrument(instrument);
+        }
+    }
+}
+
+bool Engine::isDeterministic () const {
+    return m_Deterministic;
+}
+
+void Engine::seedInstrument (Instrument::Instrument* a_Instrument) {
+    a_Instrument->setRandomSeed(Utils::mixSeed(
+        m_Seed, Utils::hashString(a_Instrument->getName())
+    ));
+}
+
+// ============================================================================
+
+void Engine::pushEvent (const MIDI::Event& a_Event) {
+
+    // Make the event time absolute
+    MIDI::Event event = a_Event;
+    event.time += m_Time;
+
+    // Insert, keep the queue sorted by time
+    auto itr = std::upper_bound(m_Events.begin(), m_Events.end(), event,
+        [](MIDI::Event const& a, MIDI::Event const& b) {
+            return a.time < b.time;
+        });
+
+    m_Events.insert(itr, event);
+}
+
+// ============================================================================
+
+void Engine::renderBuffer () {
+
+    // Collect events that fall into this buffer
+    m_BufferEvents.clear();
+
+    int64_t endTime = m_BufferTime + (int64_t)m_BufferSize;
+    auto    itr     = m_Events.begin();
+
+    for (; itr != m_Events.end() && itr->time < endTime; ++itr) {
+        MIDI::Event event = *itr;
+
+        // Late event. May happen if it was pushed for a time that has already
+        // been rendered to the internal buffer.
+        event.time -= m_BufferTime;
+        if (event.time < 0) {
+            event.log(m_Logger.get(), spdlog::level::warn);
+            event.time = 0;
+        }
+
+        m_BufferEvents.push_back(event);
+    }
+
+    m_Events.erase(m_Events.begin(), itr);
+
+    // Process
+    process(m_BufferEvents, m_Buffer);
+
+    m_BufferTime += m_BufferSize;
+    m_BufferPos   = 0;
+}
+
+void Engine::render (float* a_Data, size_t a_Frames) {
+
+    while (a_Frames) {
+
+        // Render the next internal buffer
+        if (m_BufferPos >= m_BufferSize) {
+            renderBuffer();
+        }
+
+        // Interleave
+        size_t count = std::min(a_Frames, m_BufferSize - m_BufferPos);
+        Audio::Kernels::interleave(a_Data,
+            m_Buffer.data(0) + m_BufferPos,
+            m_Buffer.data(1) + m_BufferPos,
+            count
+        );
+
+        a_Data      += 2 * count;
+        m_BufferPos += count;
+        m_Time      += count;
+        a_Frames    -= count;
+    }
+}
+
+void Engine::render (float* a_Left, float* a_Right, size_t a_Frames) {
+
+    while (a_Frames) {
+
+        // Render the next internal buffer
+        if (m_BufferPos >= m_BufferSize) {
+            renderBuffer();
+        }
+
+        // Copy
+        size_t count = std::min(a_Frames, m_BufferSize - m_BufferPos);
+        size_t size  = count * sizeof(float);
+
+        memcpy(a_Left,  m_Buffer.data(0) + m_BufferPos, size);
+        memcpy(a_Right, m_Buffer.data(1) + m_BufferPos, size);
+
+        a_Left      += count;
+        a_Right     += count;
+        m_BufferPos += count;
+        m_Time      += count;
+        a_Frames    -= count;
+    }
+}
+
+// ============================================================================
+
+void Engine::process (const std::vector<MIDI::Event>& a_Events,
+                      Audio::Buffer<float>& a_Output)
+{
+    // Check the output buffer
+    if (a_Output.getSize() != m_BufferSize || a_Output.getChannels() != 2) {
+        THROW(Audio::ProcessingError,
+            "The output buffer must be stereo and %zu frames long",
+            m_BufferSize
+        );
+    }
+
+    // Route events to instruments, build a list of all active voices
+    m_Router.route(a_Events);
+
+    m_ActiveVoices.clear();
+    for (size_t i=0; i<m_InstrumentOrder.size(); ++i) {
+        m_InstrumentOrder[i]->processEvents(m_Router.getEvents(i), m_ActiveVoices);
+    }
+
+    // Deterministic mixing
+    if (m_Deterministic) {
+        processDeterministic(a_Output);
+        return;
+    }
+
+    auto& activeVoices = m_ActiveVoices;
+
+#ifdef SYNTH_USE_TBB
+
+    // Process voices, each one accumulates to the bus of its thread
+    tbb::parallel_for( tbb::blocked_range<size_t>(0, activeVoices.size()),
+        [&](const tbb::blocked_range<size_t>& r) {
+            auto& bus = m_Buses.local();
+            for (size_t i=r.begin(); i!=r.end(); ++i) {
+                auto& voice = activeVoices[i];
+                voice->process(bus);
+            }
+        }
+    );
+
+    // Reduce thread buses into the output in parallel over frame ranges.
+    // Clear the buses on the way for the next call.
+    tbb::parallel_for( tbb::blocked_range<size_t>(0, m_BufferSize, 64),
+        [&](const tbb::blocked_range<size_t>& r) {
+            size_t count = r.end() - r.begin();
+
+            for (size_t c=0; c<2; ++c) {
+                float* dst = a_Output.data(c) + r.begin();
+                memset(dst, 0, count * sizeof(float));
+
+                for (auto& bus : m_Buses) {
+                    float* src = bus.data(c) + r.begin();
+                    Audio::Kernels::add(dst, src, count);
+                    memset(src, 0, count * sizeof(float));
+                }
+            }
+        }
+    );
+
+#else
+
+    // Process voices, accumulate directly to the output
+    a_Output.clear();
+    for (auto& voice : activeVoices) {
+        voice->process(a_Output);
+    }
+
+#endif
+}
+
+void Engine::processDeterministic (Audio::Buffer<float>& a_Output) {
+
+    auto&  activeVoices = m_ActiveVoices;
+    size_t count        = activeVoices.size();
+
+    // Allocate a bus for each voice slot
+    while (m_VoiceBuses.size() < count) {
+        m_VoiceBuses.emplace_back(m_BufferSize, 2);
+    }
+
+    auto& buses = m_VoiceBuses;
+
+    // Process each voice to its own bus
+    auto processVoice = [&](size_t i) {
+        buses[i].clear();
+        activeVoices[i]->process(buses[i]);
+    };
+
+#ifdef SYNTH_USE_TBB
+    tbb::parallel_for( tbb::blocked_range<size_t>(0, count),
+        [&](const tbb::blocked_range<size_t>& r) {
+            for (size_t i=r.begin(); i!=r.end(); ++i) {
+                processVoice(i);
+            }
+        }
+    );
+#else
+    for (size_t i=0; i<count; ++i) {
+        processVoice(i);
+    }
+#endif
+
+    // Pairwise summation tree. The order of additions depends only on the
+    // voice slot, not on how the work got scheduled.
+    auto addBuses = [&](size_t i, size_t stride) {
+        buses[i] += buses[i + stride];
+    };
+
+    for (size_t stride=1; stride<count; stride *= 2) {
+        size_t pairs = (count - stride + 2 * stride - 1) / (2 * stride);
+
+#ifdef SYNTH_USE_TBB
+        tbb::parallel_for( tbb::blocked_range<size_t>(0, pairs),
+            [&](const tbb::blocked_range<size_t>& r) {
+                for (size_t p=r.begin(); p!=r.end(); ++p) {
+                    addBuses(p * 2 * stride, stride);
+                }
+            }
+        );
+#else
+        for (size_t p=0; p<pairs; ++p) {
+            addBuses(p * 2 * stride, stride);
+        }
+#endif
+    }
+
+    // Output
+    if (count) {
+        buses[0].copyTo(a_Output);
+    } else {
+        a_Output.clear();
+    }
+}
+
+// ============================================================================
+
+}; // Engine
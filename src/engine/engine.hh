@@ -0,0 +1,155 @@
+#ifndef ENGINE_ENGINE_HH
+#define ENGINE_ENGINE_HH
+
+#include "midi_router.hh"
+
+#include <audio/buffer.hh>
+#include <midi/event.hh>
+
+#include <instrument/factory.hh>
+#include <instrument/voice.hh>
+#include <instrument/voice_pool.hh>
+
+#include <spdlog/spdlog.h>
+
+#ifdef SYNTH_USE_TBB
+#include <tbb/enumerable_thread_specific.h>
+#endif
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Engine {
+
+// ============================================================================
+
+/// The embeddable synthesis engine. Holds instruments and renders their
+/// voices into caller provided buffers. Has no dependency on any audio or MIDI
+/// device. Not thread safe, all calls must be made from a single thread.
+class Engine {
+public:
+
+    /// Constructor. The buffer size is the render quantum, the number of
+    /// frames the instrument graphs process at a time. It is independent of
+    /// the number of frames requested by render() so a small one keeps the
+    /// graph working set in cache and MIDI event timing fine.
+    Engine (size_t a_SampleRate, size_t a_BufferSize);
+
+    /// Returns the sample rate
+    size_t getSampleRate () const;
+    /// Returns the render quantum (in frames)
+    size_t getBufferSize () const;
+
+    /// Loads instruments from an XML file. Instruments with names that are
+    /// already present are skipped.
+    void loadInstruments   (const std::string& a_Config);
+    /// Deletes all instruments
+    void deleteInstruments ();
+    /// Returns the instruments
+    Instrument::Instruments& getInstruments ();
+
+    /// Limits the count of voices built across all instruments and their
+    /// estimated memory in bytes. Limits of 0 mean no limit. Instruments
+    /// build voices on demand and reclaim idle ones of each other to stay
+    /// within the limits.
+    void setVoiceLimits (size_t a_MaxVoices, size_t a_MaxMemory = 0);
+    /// Returns voice pool statistics
+    const Instrument::VoicePool::Stats& getVoiceStats () const;
+
+    /// Enables or disables the deterministic mode. When enabled voices are
+    /// mixed in a fixed order keyed by instrument name and voice slot and
+    /// every voice gets a reproducible random seed derived from the given one.
+    /// The output is then bit-identical regardless of the thread count.
+    /// Seeds already given to voices are kept when the mode is disabled.
+    void setDeterministic (bool a_Enable, uint32_t a_Seed = 0);
+    /// Returns true when the deterministic mode is enabled
+    bool isDeterministic () const;
+
+    /// Queues a MIDI event. The event time is a sample offset relative to the
+    /// first frame rendered by the next render() call.
+    void pushEvent (const MIDI::Event& a_Event);
+
+    /// Renders frames as interleaved stereo samples (L, R, L, R, ...). The
+    /// frames are assembled from as many render quanta as needed, queued
+    /// events are split at quantum boundaries.
+    void render (float* a_Data, size_t a_Frames);
+    /// Renders frames to separate left and right channel buffers
+    void render (float* a_Left, float* a_Right, size_t a_Frames);
+
+    /// Processes a single buffer of getBufferSize() frames. Event times are
+    /// sample offsets within the buffer. The output must be a stereo buffer.
+    void process (const std::vector<MIDI::Event>& a_Events,
+                  Audio::Buffer<float>& a_Output);
+
+protected:
+
+    /// Renders the next internal buffer using queued events
+    void renderBuffer ();
+
+    /// Rebuilds the instrument processing order and MIDI routing
+    void updateInstrumentOrder ();
+    /// Seeds all voices of an instrument for the deterministic mode
+    void seedInstrument (Instrument::Instrument* a_Instrument);
+
+    /// Processes active voices into separate buffers and mixes them using
+    /// a fixed pairwise summation tree.
+    void processDeterministic (Audio::Buffer<float>& a_Output);
+
+    /// Logger
+    std::shared_ptr<spdlog::logger> m_Logger;
+
+    /// Sample rate
+    const size_t m_SampleRate;
+    /// Buffer size
+    const size_t m_BufferSize;
+
+    /// Voice pool shared by all instruments. Must outlive them.
+    Instrument::VoicePool   m_VoicePool;
+    /// Instruments
+    Instrument::Instruments m_Instruments;
+    /// Instruments sorted by name
+    std::vector<Instrument::Instrument*> m_InstrumentOrder;
+    /// MIDI event router, indexed by the instrument order
+    MidiRouter m_Router;
+    /// Active voice list
+    std::vector<Instrument::Voice*> m_ActiveVoices;
+
+    /// Deterministic mode flag
+    bool     m_Deterministic = false;
+    /// Deterministic mode seed
+    uint32_t m_Seed = 0;
+    /// Per-voice stereo buffers for the deterministic mode
+    std::vector<Audio::Buffer<float>> m_VoiceBuses;
+
+#ifdef SYNTH_USE_TBB
+    /// Per-thread stereo mix buses. Voices accumulate their output directly
+    /// into the bus of the thread that processes them. The buses are kept
+    /// cleared between calls to process().
+    tbb::enumerable_thread_specific<Audio::Buffer<float>> m_Buses;
+#endif
+
+    /// Queued MIDI events. Times are absolute [samples]
+    std::vector<MIDI::Event> m_Events;
+    /// Events for the buffer being rendered
+    std::vector<MIDI::Event> m_BufferEvents;
+
+    /// Absolute time of the next frame returned by render() [samples]
+    int64_t m_Time = 0;
+    /// Absolute time of the next internal buffer [samples]
+    int64_t m_BufferTime = 0;
+
+    /// Internal stereo buffer
+    Audio::Buffer<float> m_Buffer;
+    /// Read position within the internal buffer
+    size_t m_BufferPos;
+};
+
+// ============================================================================
+
+}; // Engine
+
+#endif // ENGINE_ENGINE_HH
@@ -0,0 +1,107 @@
+#include "midi_router.hh"
+
+#include <cassert>
+
+namespace Engine {
+
+// ============================================================================
+
+constexpr size_t MidiRouter::CHANNELS;
+constexpr size_t MidiRouter::NOTES;
+
+// ============================================================================
+
+void MidiRouter::build (const std::vector<Instrument::Instrument*>& a_Instruments) {
+
+    m_NoteOffsets.clear();
+    m_Notes.clear();
+    m_ChannelOffsets.clear();
+    m_Channels.clear();
+
+    // Notes
+    for (size_t c=0; c<CHANNELS; ++c) {
+        for (size_t n=0; n<NOTES; ++n) {
+            m_NoteOffsets.push_back(m_Notes.size());
+
+            for (size_t i=0; i<a_Instruments.size(); ++i) {
+                if (a_Instruments[i]->acceptsNote(c, n)) {
+                    m_Notes.push_back(i);
+                }
+            }
+        }
+    }
+
+    m_NoteOffsets.push_back(m_Notes.size());
+
+    // Channels
+    for (size_t c=0; c<CHANNELS; ++c) {
+        m_ChannelOffsets.push_back(m_Channels.size());
+
+        for (size_t i=0; i<a_Instruments.size(); ++i) {
+            if (a_Instruments[i]->acceptsChannel(c)) {
+                m_Channels.push_back(i);
+            }
+        }
+    }
+
+    m_ChannelOffsets.push_back(m_Channels.size());
+
+    // Event lists
+    m_Events.resize(a_Instruments.size());
+    for (auto& events : m_Events) {
+        events.clear();
+    }
+}
+
+// ============================================================================
+
+void MidiRouter::deliver (const std::vector<uint32_t>& a_Offsets,
+                          const std::vector<uint32_t>& a_Targets,
+                          size_t a_Entry, const MIDI::Event& a_Event)
+{
+    for (size_t i=a_Offsets[a_Entry]; i<a_Offsets[a_Entry + 1]; ++i) {
+        m_Events[a_Targets[i]].push_back(a_Event);
+    }
+}
+
+void MidiRouter::route (const std::vector<MIDI::Event>& a_Events) {
+
+    for (auto& events : m_Events) {
+        events.clear();
+    }
+
+    for (auto& event : a_Events) {
+        switch (event.type)
+        {
+        case MIDI::Event::Type::NOTE_ON:
+        case MIDI::Event::Type::NOTE_OFF: {
+            size_t channel = event.data.note.channel % CHANNELS;
+            size_t note    = event.data.note.note    % NOTES;
+            deliver(m_NoteOffsets, m_Notes, channel * NOTES + note, event);
+            break;
+        }
+
+        case MIDI::Event::Type::CONTROLLER: {
+            size_t channel = event.data.ctrl.channel % CHANNELS;
+            deliver(m_ChannelOffsets, m_Channels, channel, event);
+            break;
+        }
+
+        // System events go everywhere
+        default:
+            for (auto& events : m_Events) {
+                events.push_back(event);
+            }
+            break;
+        }
+    }
+}
+
+const std::vector<MIDI::Event>& MidiRouter::getEvents (size_t a_Index) const {
+    assert(a_Index < m_Events.size());
+    return m_Events[a_Index];
+}
+
+// ============================================================================
+
+}; // Engine
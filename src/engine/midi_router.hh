@@ -0,0 +1,61 @@
+#ifndef ENGINE_MIDI_ROUTER_HH
+#define ENGINE_MIDI_ROUTER_HH
+
+#include <midi/event.hh>
+
+#include <instrument/instrument.hh>
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Engine {
+
+// ============================================================================
+
+/// Distributes MIDI events to instruments. Lookup tables from a channel and
+/// a note to the instruments that react to them are built once when the
+/// instrument set changes so each event is only delivered where it belongs.
+class MidiRouter {
+public:
+
+    /// Count of MIDI channels
+    static constexpr size_t CHANNELS = 16;
+    /// Count of MIDI notes
+    static constexpr size_t NOTES    = 128;
+
+    /// Builds lookup tables for the given instruments. Instrument indices
+    /// used by route() and getEvents() follow the order of the vector.
+    void build (const std::vector<Instrument::Instrument*>& a_Instruments);
+
+    /// Splits events among instruments. Events of each instrument keep
+    /// their order.
+    void route (const std::vector<MIDI::Event>& a_Events);
+    /// Returns events routed to the instrument with the given index
+    const std::vector<MIDI::Event>& getEvents (size_t a_Index) const;
+
+protected:
+
+    /// Appends an event to the instruments of a table entry
+    void deliver (const std::vector<uint32_t>& a_Offsets,
+                  const std::vector<uint32_t>& a_Targets,
+                  size_t a_Entry, const MIDI::Event& a_Event);
+
+    /// Instrument indices for each channel and note in a compressed form.
+    /// Entry i spans m_Notes[m_NoteOffsets[i]] to m_Notes[m_NoteOffsets[i+1]].
+    std::vector<uint32_t> m_NoteOffsets;
+    std::vector<uint32_t> m_Notes;
+    /// Instrument indices for each channel in the same form
+    std::vector<uint32_t> m_ChannelOffsets;
+    std::vector<uint32_t> m_Channels;
+
+    /// Events routed to each instrument
+    std::vector<std::vector<MIDI::Event>> m_Events;
+};
+
+// ============================================================================
+
+}; // Engine
+
+#endif // ENGINE_MIDI_ROUTER_HH
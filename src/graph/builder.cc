@@ -17,8 +17,10 @@
 #include "modules/adsr.hh"
 #include "modules/vga.hh"
 #include "modules/vcf.hh"
+#include "modules/svf.hh"
 #include "modules/soft_clipper.hh"
 #include "modules/sampler.hh"
+#include "modules/oversampler.hh"
 
 #include <spdlog/sinks/stdout_color_sinks.h>
 
@@ -52,6 +54,7 @@ void Builder::registerBuiltinModules () {
     m_Creators.set("adsr",           std::bind(&Modules::ADSR::create,           _1, _2, _3));
     m_Creators.set("vga",            std::bind(&Modules::VGA::create,            _1, _2, _3));
     m_Creators.set("vcf",            std::bind(&Modules::VCF::create,            _1, _2, _3));
+    m_Creators.set("svf",            std::bind(&Modules::SVF::create,            _1, _2, _3));
     m_Creators.set("softClipper",    std::bind(&Modules::SoftClipper::create,    _1, _2, _3));
     m_Creators.set("sampler",        std::bind(&Modules::Sampler::create,        _1, _2, _3));
 }
@@ -160,8 +163,32 @@ Module* Builder::createModule (const std::string& a_Type, const std::string& a_N
         THROW(BuildError, "No definition for module type '%s'!", a_Type.c_str());
     }
 
-    // Create the module
-    auto module = new Module(a_Type, a_Name, a_Attributes);
+    // Oversampling factor
+    size_t factor = 1;
+    if (moduleDesc->hasAttribute("oversample")) {
+        const std::string str = moduleDesc->getAttribute("oversample");
+        try {
+            factor = std::stoul(str);
+        }
+        catch (std::logic_error&) {
+            THROW(BuildError, "Invalid oversampling factor '%s' for module "
+                "type '%s'", str.c_str(), a_Type.c_str());
+        }
+    }
+
+    // Create the module. An oversampled one has its top-level ports crossing
+    // the rate boundary.
+    Modules::Oversampler* oversampler = nullptr;
+    Module* module = nullptr;
+
+    if (factor != 1) {
+        oversampler = new Modules::Oversampler(a_Type, a_Name, factor,
+            a_Attributes);
+        module = oversampler;
+    }
+    else {
+        module = new Module(a_Type, a_Name, a_Attributes);
+    }
 
     // Add ports
     for (auto& node : moduleDesc->findAll("input")) {
@@ -170,7 +197,11 @@ Module* Builder::createModule (const std::string& a_Type, const std::string& a_N
         }
 
         const std::string portName = node->getAttribute("name");
-        module->addPort(new Port(module, portName, Port::Direction::INPUT, 0.0f));
+        if (oversampler) {
+            oversampler->addBoundaryPort(portName, Port::Direction::INPUT);
+        } else {
+            module->addPort(new Port(module, portName, Port::Direction::INPUT, 0.0f));
+        }
     }
 
     for (auto& node : moduleDesc->findAll("output")) {
@@ -179,7 +210,11 @@ Module* Builder::createModule (const std::string& a_Type, const std::string& a_N
         }
 
         const std::string portName = node->getAttribute("name");
-        module->addPort(new Port(module, portName, Port::Direction::OUTPUT, 0.0f));
+        if (oversampler) {
+            oversampler->addBoundaryPort(portName, Port::Direction::OUTPUT);
+        } else {
+            module->addPort(new Port(module, portName, Port::Direction::OUTPUT, 0.0f));
+        }
     }
 
     // Create submodules
@@ -267,7 +302,11 @@ Module* Builder::createModule (const std::string& a_Type, const std::string& a_N
             // No module name, get a top-level port
             if (pair.first.empty()) {
 
-                auto port = module->getPort(pair.second);
+                // Submodules of an oversampled module connect to the inner
+                // side of its ports
+                auto port = oversampler ?
+                    oversampler->getInnerPort(pair.second) :
+                    module->getPort(pair.second);
                 if (port == nullptr) {
                     THROW(BuildError, "Module '%s' doesn't have a port '%s'!",
                         module->getName().c_str(), pair.second.c_str()
@@ -0,0 +1,35 @@
+#ifndef GRAPH_MODULES_CONTROLLER_LISTENER_HH
+#define GRAPH_MODULES_CONTROLLER_LISTENER_HH
+
+#include <utils/base_interface.hh>
+#include <midi/controller_state.hh>
+
+#include <cstdint>
+
+namespace Graph {
+namespace Modules {
+
+// ============================================================================
+
+/// Implemented by modules that read MIDI controller values. They get them
+/// from a state block shared by all voices of an instrument instead of
+/// receiving controller events.
+class IControllerListener : public IBaseInterface {
+public:
+
+    /// Virtual desctructor
+    virtual ~IControllerListener () {};
+
+    /// Interface ID
+    static constexpr iid_t ID = INTERFACE_ID("MCTL");
+
+    /// Sets the controller state to read from. It must outlive the module.
+    virtual void setControllerState (const MIDI::ControllerState* a_State) = 0;
+};
+
+// ============================================================================
+
+}; // Modules
+}; // Graph
+
+#endif  // GRAPH_MODULES_CONTROLLER_LISTENER_HH
@@ -0,0 +1,81 @@
+#ifndef GRAPH_MODULES_HOLD_REPORTER_HH
+#define GRAPH_MODULES_HOLD_REPORTER_HH
+
+#include <utils/base_interface.hh>
+
+#include "../module.hh"
+#include "../port.hh"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Graph {
+namespace Modules {
+
+// ============================================================================
+
+/// Implemented by modules that can tell analytically when an output stops
+/// changing. Used to find voices that are provably silent without scanning
+/// their audio.
+class IHoldReporter : public IBaseInterface {
+public:
+
+    /// Virtual desctructor
+    virtual ~IHoldReporter () {};
+
+    /// Interface ID
+    static constexpr iid_t ID = INTERFACE_ID("HOLD");
+
+    /// Returned when a hold cannot be told
+    static constexpr size_t NONE = SIZE_MAX;
+
+    /// Returns the sample of the last processed buffer from which the given
+    /// output holds a constant value until the module receives new MIDI
+    /// events or gets restarted. For a control rate output it is the index
+    /// of the control value. Stores the value in a_Value. Returns NONE when
+    /// the output may still change.
+    virtual size_t getHoldStart (const Port* a_Output, float* a_Value) = 0;
+
+    /// Returns the hold start of the signal seen by the given port, as
+    /// reported by the module that produces it. Control rate signals
+    /// converted to audio rate hold from the sub-block after the one that
+    /// ramps to the held value, other conversions are not followed.
+    static size_t queryHold (Port* a_Port, float* a_Value) {
+
+        Port* source = a_Port;
+        if (a_Port->getType() == Port::Type::PROXY) {
+            source = a_Port->getSource();
+            if (source == nullptr) {
+                return NONE;
+            }
+        }
+
+        bool ramped = (source->getRate() == Port::Rate::CONTROL &&
+                       a_Port->getRate() == Port::Rate::AUDIO);
+
+        if (source->getRate() != a_Port->getRate() && !ramped) {
+            return NONE;
+        }
+
+        auto iface = (IHoldReporter*)source->getModule()->queryInterface(ID);
+        if (iface == nullptr) {
+            return NONE;
+        }
+
+        size_t start = iface->getHoldStart(source, a_Value);
+        if (start == NONE || !ramped) {
+            return start;
+        }
+
+        // The ramp reaches the value at the end of its sub-block, exactly
+        // from the next one on
+        return (start + 1) * Port::CONTROL_PERIOD;
+    }
+};
+
+// ============================================================================
+
+}; // Modules
+}; // Graph
+
+#endif  // GRAPH_MODULES_HOLD_REPORTER_HH
@@ -12,6 +12,15 @@ namespace Graph {
 
 // ============================================================================
 
+namespace {
+
+/// Use of fixed size kernels
+bool g_FixedSizeKernels = true;
+
+}; // Anonymous
+
+// ============================================================================
+
 Module::Module (const std::string& a_Type, const std::string& a_Name,
                 const Attributes& a_Attributes) :
     m_Type       (a_Type),
@@ -128,6 +137,11 @@ Port* Module::addPort (Port* a_Port) {
     return a_Port;
 }
 
+void Module::preparePort (Port* a_Port, size_t a_BufferSize) {
+    a_Port->updateSourcesAndSinks();
+    a_Port->setBuffer(Audio::Buffer<float>(a_Port->getBufferSize(a_BufferSize), 1));
+}
+
 void Module::connect (Port* a_Src, Port* a_Dst) {
 
     // Don't connect from input except from a top-level input.
@@ -180,10 +194,10 @@ void Module::prepare (float a_SampleRate, size_t a_BufferSize) {
         port->updateSourcesAndSinks();
     }
 
-    // Set new buffers in all ports
+    // Set new buffers in all ports, sized according to their rates
     for (auto& itr : m_Ports) {
         auto& port = itr.second;
-        port->setBuffer(Audio::Buffer<float>(a_BufferSize, 1));
+        port->setBuffer(Audio::Buffer<float>(port->getBufferSize(a_BufferSize), 1));
     }
 
     // Call on all submodules
@@ -195,6 +209,11 @@ void Module::prepare (float a_SampleRate, size_t a_BufferSize) {
 
 void Module::start () {
 
+    // Reset ports
+    for (auto& itr : m_Ports) {
+        itr.second->reset();
+    }
+
     // Call on all submodules
     for (auto& it : m_Submodules) {
         auto child = it.second;
@@ -211,12 +230,46 @@ void Module::stop () {
     }
 }
 
+void Module::setRandomSeed (uint32_t a_Seed) {
+
+    // Derive a distinct seed for each submodule
+    for (auto& it : m_Submodules) {
+        auto child = it.second;
+        child->setRandomSeed(Utils::mixSeed(a_Seed,
+            Utils::hashString(child->getName())));
+    }
+}
+
 void Module::process () {
     // Empty
 }
 
 // ============================================================================
 
+void Module::setFixedSizeKernels (bool a_Enable) {
+    g_FixedSizeKernels = a_Enable;
+}
+
+size_t Module::getFixedKernelSize (size_t a_BufferSize) {
+
+    if (!g_FixedSizeKernels) {
+        return 0;
+    }
+
+    switch (a_BufferSize)
+    {
+    case 32:
+    case 64:
+    case 128:
+    case 256:
+        return a_BufferSize;
+    default:
+        return 0;
+    }
+}
+
+// ============================================================================
+
 const Module::Attributes Module::getAttributes () const {
     Attributes attributes;
 
@@ -343,6 +396,23 @@ void Module::updateParameters (const Module::ParameterValues& a_Values) {
     }
 }
 
+size_t Module::getMemoryUsage () const {
+    size_t size = 0;
+
+    // Port buffers
+    for (auto& it : m_Ports) {
+        auto& buffer = it.second->m_Buffer;
+        size += buffer.getSize() * buffer.getChannels() * sizeof(float);
+    }
+
+    // Submodules
+    for (auto& it : m_Submodules) {
+        size += it.second->getMemoryUsage();
+    }
+
+    return size;
+}
+
 
 // ============================================================================
 
@@ -85,9 +85,18 @@ public:
     /// Called on audio processing stop
     virtual void stop    ();
 
+    /// Sets a reproducible random seed. Must be called before start(). The
+    /// default implementation passes seeds derived from the given one and
+    /// submodule names to all submodules.
+    virtual void setRandomSeed (uint32_t a_Seed);
+
     /// Processes a single audio buffer
     virtual void process ();
 
+    /// Enables or disables kernels specialized for fixed buffer sizes.
+    /// Takes effect on the next prepare(). Meant for benchmarking.
+    static void setFixedSizeKernels (bool a_Enable);
+
     /// Returns module attributes
     const Attributes getAttributes () const;
     /// Returns module parameters
@@ -95,10 +104,17 @@ public:
     /// Updates module parameters
     virtual void updateParameters (const ParameterValues& a_Values);
 
+    /// Returns an estimate of the memory used by buffers of the module and
+    /// all its submodules in bytes
+    virtual size_t getMemoryUsage () const;
+
 protected:
 
     /// Adds a new port, returns a pointer to it
     Port* addPort (Port* a_Port);
+    /// Discovers sources and sinks of a port and sets a new buffer of the
+    /// given size to it.
+    void preparePort (Port* a_Port, size_t a_BufferSize);
     /// Connects two ports. Either a submodule output to a submodule input or
     /// top-level input/output to a submodule input/output.
     void connect (Port* a_Src, Port* a_Dst);
@@ -106,6 +122,11 @@ protected:
     /// Applies parameter overrides
     void applyParameterOverrides (const Module::Attributes& a_Overrides);
 
+    /// Returns the buffer size to select a fixed size kernel for or 0 when
+    /// a runtime size one should be used. Fixed size kernels exist for 32,
+    /// 64, 128 and 256 samples.
+    static size_t getFixedKernelSize (size_t a_BufferSize);
+
     // ....................................................
 
     /// Type
@@ -1,4 +1,5 @@
 #include "adder.hh"
+#include <audio/kernels.hh>
 
 #include <stringf.hh>
 
@@ -61,31 +62,52 @@ void Adder::prepare (float a_SampleRate, size_t a_BufferSize) {
             m_Gain[i]->setLock(true);
         }
     }
+
+    // Select the kernel
+    m_Kernel = selectKernel(a_BufferSize);
 }
 
 // ============================================================================
 
-void Adder::process () {
+template <size_t N>
+void Adder::processBuffer () {
 
-    // Clear output buffer
-    m_Output->getBuffer().fill(m_Bias->get().asNumber());
+    const size_t size = N ? N : m_BufferSize;
 
-    // Process
+    // Clear output buffer
     float* ptrOut = m_Output->getBuffer().data();
+    Audio::Kernels::Fixed<N>::fill(ptrOut, m_Bias->get().asNumber(), size);
 
+    // Process
     for (size_t j=0; j<m_Inputs.size(); ++j) {
         float gain  = m_Gain[j]->get().asNumber();
         auto  port  = m_Inputs[j];
 
         const float* ptrIn = port->process().data();
-        for (size_t i=0; i<m_BufferSize; ++i) {
-            ptrOut[i] += (ptrIn[i] * gain);
-        }
+        Audio::Kernels::Fixed<N>::mac(ptrOut, ptrIn, gain, size);
+    }
+}
+
+Adder::Kernel Adder::selectKernel (size_t a_BufferSize) {
+
+    switch (getFixedKernelSize(a_BufferSize))
+    {
+    case 32:  return &Adder::processBuffer<32>;
+    case 64:  return &Adder::processBuffer<64>;
+    case 128: return &Adder::processBuffer<128>;
+    case 256: return &Adder::processBuffer<256>;
+    default:  return &Adder::processBuffer<0>;
     }
 }
 
 // ============================================================================
 
+void Adder::process () {
+    (this->*m_Kernel)();
+}
+
+// ============================================================================
+
 }; // Modules
 }; // Graph
 
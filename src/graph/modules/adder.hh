@@ -38,6 +38,19 @@ public:
 
 protected:
 
+    /// Kernel type
+    typedef void (Adder::*Kernel) ();
+
+    /// Processes a buffer of N samples, of m_BufferSize ones when N is 0
+    template <size_t N>
+    void processBuffer ();
+
+    /// Selects a kernel for the buffer size
+    static Kernel selectKernel (size_t a_BufferSize);
+
+    /// Kernel
+    Kernel m_Kernel = nullptr;
+
     /// Output port
     Port* m_Output;
     /// Input ports
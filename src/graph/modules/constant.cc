@@ -10,8 +10,9 @@ Constant::Constant (const std::string& a_Name,
                     const Module::Attributes& a_Attributes) :
     Module ("constant", a_Name, a_Attributes)
 {
-    // Output port
-    m_Output = addPort(new Port(this, "out", Port::Direction::OUTPUT));
+    // Output port, control rate
+    m_Output = addPort(new Port(this, "out", Port::Direction::OUTPUT,
+        Port::Rate::CONTROL));
 
     // The parameter
     m_Parameters.set("value", Parameter(0.0f, 0.0f, 1.0f, 0.01f, "Value"));
@@ -7,8 +7,12 @@
 #include <strutils.hh>
 #include <stringf.hh>
 #include <utils/utils.hh>
+#include <utils/math.hh>
 #include <utils/exception.hh>
 
+#include <audio/kernels.hh>
+
+#include <algorithm>
 #include <regex>
 #include <cmath>
 
@@ -22,10 +26,30 @@ Envelope::Envelope (const std::string& a_Type,
                     const Module::Attributes& a_Attributes) :
     Module (a_Type, a_Name, a_Attributes)
 {
+    // Output rate. The gate is always read at the audio rate, edges are
+    // sample accurate.
+    auto rate = a_Attributes.get("rate", "audio");
+    if (rate == "control") {
+        m_ControlRate = true;
+    }
+    else if (rate != "audio") {
+        THROW(BuildError, "Invalid envelope rate '%s'", rate.c_str());
+    }
+
     // Input ports
     m_Gate   = addPort(new Port(this, "gate", Port::Direction::INPUT, 0.0f));
     // Output ports
-    m_Output = addPort(new Port(this, "out",  Port::Direction::OUTPUT));
+    m_Output = addPort(new Port(this, "out",  Port::Direction::OUTPUT,
+        m_ControlRate ? Port::Rate::CONTROL : Port::Rate::AUDIO));
+
+    // Output scale
+    auto scale = a_Attributes.get("scale", "db");
+    if (scale == "linear") {
+        m_Linear = true;
+    }
+    else if (scale != "db") {
+        THROW(BuildError, "Invalid envelope scale '%s'", scale.c_str());
+    }
 
     // Parse attributes to get points
     std::regex expr("point([0-9]+)");
@@ -87,6 +111,18 @@ Module* Envelope::create (
 
 // ============================================================================
 
+IBaseInterface* Envelope::queryInterface (iid_t a_Id) {
+
+    // We have IHoldReporter
+    if (a_Id == IHoldReporter::ID) {
+        return static_cast<IHoldReporter*>(this);
+    }
+
+    return Module::queryInterface(a_Id);
+}
+
+// ============================================================================
+
 void Envelope::sanityCheckPoints() {
 
     // There have to be at least 2 points.
@@ -118,6 +154,9 @@ void Envelope::sanityCheckPoints() {
 
 void Envelope::start () {
 
+    // Call the base method
+    Module::start();
+
     // There have to be at least 2 points.
     if (m_Points.size() < 2) {
         throw ModuleError("There has to be at least two envelope points");
@@ -127,112 +166,200 @@ void Envelope::start () {
     stop();
 
     // Set the starting level
-    m_CurrLevel = m_Points[0].level;
+    m_Time     = 0;
+    m_SegTime  = 0;
+    m_SegLevel = m_Points[0].level;
 }
 
 void Envelope::stop () {
 
     // Reset
+    m_Events.clear();
+    m_NextEvent  = 0;
+
     m_IsActive   = false;
-    m_LevelDelta = 0.0;
+    m_LevelDelta = 0.0f;
     m_GateState  = 0.0f;
 }
 
 // ============================================================================
 
-void Envelope::scheduleEvents (int32_t a_Sample, bool a_Attack) {
-    //auto logger = m_Pipeline->getLogger();
+void Envelope::scheduleEvents (int64_t a_Time, bool a_Attack) {
 
     // Remove all events
     m_Events.clear();
 
-    // Schedule attack + sustain
+    // Attack starts at the first point, release at the sustain point or at
+    // the one before the last if there is none.
+    size_t first = 0;
+    size_t last  = m_Points.size();
+
     if (a_Attack) {
-        int32_t prevTime = -1;
         for (size_t i=0; i<m_Points.size(); ++i) {
-            auto&   point = m_Points[i];
-            int32_t time  = (int32_t)(point.time * m_SampleRate + 0.5f) + a_Sample;
-
-            if (time <= prevTime) {
-                time  = prevTime + 1;
+            if (m_Points[i].isSustain) {
+                last = i + 1;
+                break;
             }
-            prevTime = time;
-
-            m_Events.push_back(Event(time, point));
-            //logger->debug("A: t={}, l={}", time, point.level);
-
-            if (point.isSustain) {
+        }
+    }
+    else {
+        for (first=0; first<m_Points.size(); ++first) {
+            if (m_Points[first].isSustain) {
                 break;
             }
         }
 
-        // Set the start level
-        if (!m_IsActive) {
-            m_CurrLevel = m_Events.front().level;
+        if (first == m_Points.size()) {
+            first -= 2;
         }
     }
 
-    // Schedule release
-    else {
-        size_t i;
+    // Schedule events relative to the first one which happens now
+    const int64_t base = (int64_t)(m_Points[first].time * m_SampleRate + 0.5f);
 
-        // Find the sustain point
-        for (i=0; i<m_Points.size(); ++i) {
-            auto& point = m_Points[i];
-            if (point.isSustain) {
-                break;
-            }
+    int64_t prevTime = a_Time - 1;
+    for (size_t i=first; i<last; ++i) {
+        auto&   point = m_Points[i];
+        int64_t time  = (int64_t)(point.time * m_SampleRate + 0.5f) - base + a_Time;
+
+        if (time <= prevTime) {
+            time  = prevTime + 1;
         }
+        prevTime = time;
+
+        m_Events.push_back(Event(time, point));
+    }
+
+    // The first event is the start of the curve
+    m_NextEvent = 1;
+}
+
+void Envelope::startSegment (int64_t a_Time, float a_Level) {
+
+    m_SegTime  = a_Time;
+    m_SegLevel = a_Level;
+
+    // Linear segment up to the next event
+    if (m_NextEvent < m_Events.size()) {
+        auto& event = m_Events[m_NextEvent];
+        m_LevelDelta = (event.level - a_Level) / (float)(event.time - a_Time);
+    }
+    // Hold
+    else {
+        m_LevelDelta = 0.0f;
+    }
+}
+
+// ============================================================================
+
+void Envelope::ramp (float* a_Out, float a_Level, size_t a_Count) const {
+
+    // Constant
+    if (m_LevelDelta == 0.0f) {
+        float level = m_Linear ? Utils::Math::fastLog2lin(a_Level) : a_Level;
+        Audio::Kernels::fill(a_Out, level, a_Count);
+        return;
+    }
 
-        // No sustain point found, schedule only the last two
-        if (i == m_Points.size()) {
-            i -= 2;
+    // A linear segment in dB
+    if (!m_Linear) {
+        for (size_t i=0; i<a_Count; ++i) {
+            a_Out[i] = a_Level + (float)i * m_LevelDelta;
         }
+        return;
+    }
 
-        // Echedule events
-        int32_t prevTime = -1;
-        for (; i<m_Points.size(); ++i) {
-            auto&   point = m_Points[i];
-            int32_t time  = (int32_t)(point.time * m_SampleRate + 0.5f) + a_Sample;
+    // An exponential segment of linear gain. Computed as a geometric
+    // sequence in lanes of 8 to avoid the dB conversion of every sample.
+    const size_t LANES = 8;
+    const float  k     = m_LevelDelta * (3.321928095f / 20.0f);
 
-            if (time <= prevTime) {
-                time  = prevTime + 1;
-            }
-            prevTime = time;
+    float steps[LANES];
+    for (size_t j=0; j<LANES; ++j) {
+        steps[j] = Utils::Math::fastExp2((float)j * k);
+    }
 
-            m_Events.push_back(Event(time, point));
-            //logger->debug("R: t={}, l={}", time, point.level);
+    float gain = Utils::Math::fastLog2lin(a_Level);
+    float mul  = Utils::Math::fastExp2((float)LANES * k);
+
+    size_t i = 0;
+    for (; i + LANES <= a_Count; i += LANES) {
+        for (size_t j=0; j<LANES; ++j) {
+            a_Out[i + j] = gain * steps[j];
         }
+        gain *= mul;
+    }
+    for (size_t j=0; i<a_Count; ++i, ++j) {
+        a_Out[i] = gain * steps[j];
     }
 }
 
-void Envelope::nextEvent () {
-    //auto logger = m_Pipeline->getLogger();
+void Envelope::output (float* a_Out, float a_Level, size_t a_Begin,
+                       size_t a_Count) const
+{
+    if (!m_ControlRate) {
+        ramp(a_Out + a_Begin, a_Level, a_Count);
+        return;
+    }
 
-    // Get pop the current event
-    auto currEvent = m_Events.front();
-    m_Events.pop_front();
+    // Control rate, compute the last sample of each sub-block in the range.
+    // The last sub-block of the buffer may be shorter.
+    const size_t P   = Port::CONTROL_PERIOD;
+    const size_t end = a_Begin + a_Count;
 
-    // No more events
-    if (m_Events.empty()) {
-        m_LevelDelta = 0.0;
+    size_t i = (a_Begin / P) * P + P - 1;
+    for (; i < end; i += P) {
+        float level = a_Level + (float)(i - a_Begin) * m_LevelDelta;
+        a_Out[i / P] = m_Linear ? Utils::Math::fastLog2lin(level) : level;
+    }
 
-        //logger->debug("No more events, delta=0.0");
+    if (a_Count != 0 && end == m_BufferSize && (end % P) != 0) {
+        float level = a_Level + (float)(end - 1 - a_Begin) * m_LevelDelta;
+        a_Out[(end - 1) / P] = m_Linear ? Utils::Math::fastLog2lin(level) : level;
     }
-    // Compute the delta between the present and the next event
-    else {
-        auto& nextEvent = m_Events.front();
+}
+
+void Envelope::render (float* a_Out, const float* a_Gate, size_t a_Begin,
+                       size_t a_End)
+{
+    while (a_Begin < a_End) {
+        int64_t time = m_Time + a_Begin;
+
+        // Holding the level
+        if (m_NextEvent >= m_Events.size()) {
+            output(a_Out, m_SegLevel, a_Begin, a_End - a_Begin);
+            return;
+        }
 
-        float dt = nextEvent.time  - currEvent.time;
-        float dl = nextEvent.level - m_CurrLevel;
+        // Render the segment up to and including the event
+        const Event event = m_Events[m_NextEvent];
+        size_t count = (size_t)std::min<int64_t>(
+            a_End - a_Begin, event.time - time + 1
+        );
+
+        output(a_Out, getLevel(time), a_Begin, count);
+        a_Begin += count;
+
+        if (time + (int64_t)count <= event.time) {
+            break;
+        }
 
-        m_LevelDelta = (double)dl / (double)dt;
+        // Got an event, start the next segment
+        m_NextEvent++;
 
-        //logger->debug("Next event, t={}->{}, l={}->{}, delta={}",
-        //    currEvent.time, nextEvent.time,
-        //    m_CurrLevel, nextEvent.level,
-        //    m_LevelDelta
-        //);
+        // Sustain point with the gate already released, schedule release
+        if (m_NextEvent >= m_Events.size() && event.isSustain &&
+            a_Gate[a_Begin - 1] <= 0.5f)
+        {
+            scheduleEvents(event.time, false);
+        }
+
+        startSegment(event.time, event.level);
+
+        // End of release
+        if (m_NextEvent >= m_Events.size() && !event.isSustain) {
+            m_IsActive = false;
+        }
     }
 }
 
@@ -242,98 +369,80 @@ void Envelope::process () {
     const float* ptrGate = m_Gate->process().data();
     float*       ptrOut  = m_Output->getBuffer().data();
 
-    // Shift all events back
-    for (auto& ev : m_Events) {
-        ev.time -= m_BufferSize;
-        if (ev.time < 0) {
-            THROW(ProcessingError, "Negative envelope point time %d!",
-                ev.time
-            );
+    // Render segments in between gate edges
+    size_t begin = 0;
+    for (size_t i=0; i<m_BufferSize; ++i) {
+        float gate    = ptrGate[i];
+        float trigger = gate - m_GateState;
+        m_GateState   = gate;
+
+        if (trigger > -0.5f && trigger < 0.5f) {
+            continue;
         }
-    }
 
-    // Next event time
-    int32_t nextTime = -1;
-    if (!m_Events.empty()) {
-        nextTime = m_Events.front().time;
-    }
+        // Render up to the edge
+        render(ptrOut, ptrGate, begin, i);
+        begin = i;
 
-    // Process the buffer
-    for (size_t i=0; i<m_BufferSize; ++i) {
-        float gate = *ptrGate++;
-
-        // Detect trigger
-        float trigger;
-        if (i == 0) {
-            trigger = gate - m_GateState;
-        } else {
-            trigger = gate - *(ptrGate - 2);
-        }
+        int64_t time = m_Time + i;
 
         // Got a trigger
         if (trigger > 0.5f) {
-            scheduleEvents(i, true);
-            nextEvent();
+            float level = m_IsActive ? getLevel(time) : m_Points[0].level;
+
+            scheduleEvents(time, true);
+            startSegment(time, level);
 
             m_IsActive = true;
-            nextTime   = m_Events.front().time;
         }
 
         // Got a trigger release while in sustain
-        else if (trigger < -0.5f && m_IsActive && nextTime == -1) {
-            scheduleEvents(i, false);
-            nextEvent();
-            nextTime = m_Events.front().time;
-        }
+        else if (m_IsActive && m_NextEvent >= m_Events.size()) {
+            float level = getLevel(time);
 
-        // Got an event
-        else if ((int32_t)i == nextTime) {
-            auto event = m_Events.front();
-            nextEvent();
+            scheduleEvents(time, false);
+            startSegment(time, level);
 
-            // Got a next one
-            if (!m_Events.empty()) {
-                nextTime = m_Events.front().time;
-            }
-            // Sustain point, no next event
-            else if (event.isSustain) {
-
-                // Gate still active, keep sustain
-                if (gate > 0.5f) {
-                    nextTime = -1;
-                    //logger->debug("Sustain");
-                }
-                // Gate not active, schedule release
-                else {
-                    scheduleEvents(i, false);
-                    nextEvent();
-                    nextTime = m_Events.front().time;
-                }
-            }
-            // End of release
-            else {
-                nextTime    = -1;
-                m_IsActive  = false;
-                m_CurrLevel = event.level;
-                //logger->debug("End");
+            if (m_NextEvent >= m_Events.size()) {
+                m_IsActive = false;
             }
         }
+    }
 
-        // Generate the envelope
-        else {
-            m_CurrLevel += m_LevelDelta;
-        }
+    // Render the rest
+    render(ptrOut, ptrGate, begin, m_BufferSize);
+    m_Time += m_BufferSize;
+}
+
+// ============================================================================
+
+size_t Envelope::getHoldStart (const Port* a_Output, float* a_Value) {
 
-        // Output the envelope
-        *ptrOut++ = (float)m_CurrLevel;
+    // Still moving towards an event
+    if (a_Output != m_Output || m_NextEvent < m_Events.size()) {
+        return NONE;
     }
 
-    // Store the last gate state
-    m_GateState = *(ptrGate - 1);
+    // A gate edge would restart the curve
+    float  gate;
+    size_t gateStart = IHoldReporter::queryHold(m_Gate, &gate);
+    if (gateStart == NONE) {
+        return NONE;
+    }
+
+    // The segment start sample still comes from the ramp leading to it, hold
+    // from the next one.
+    int64_t bufferTime = m_Time - (int64_t)m_BufferSize;
+    size_t  segStart   = (size_t)std::max<int64_t>(m_SegTime + 1 - bufferTime, 0);
+
+    *a_Value = m_Linear ? Utils::Math::fastLog2lin(m_SegLevel) : m_SegLevel;
+    size_t start = std::max(gateStart, segStart);
+
+    // Control values hold from the sub-block that ends past the start
+    return m_ControlRate ? start / Port::CONTROL_PERIOD : start;
 }
 
 // ============================================================================
 
 }; // Modules
 }; // Graph
-
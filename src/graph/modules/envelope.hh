@@ -2,10 +2,11 @@
 #define GRAPH_MODULES_ENVELOPE_HH
 
 #include "../module.hh"
+#include "../iface/hold_reporter.hh"
 
 #include <memory>
 #include <string>
-#include <deque>
+#include <vector>
 
 #include <cstddef>
 #include <cstdint>
@@ -15,7 +16,7 @@ namespace Modules {
 
 // ============================================================================
 
-class Envelope : public Module {
+class Envelope : public Module, public IHoldReporter {
 public:
 
     /// An envelope point
@@ -46,6 +47,9 @@ public:
         const Module::Attributes& a_Attributes = Module::Attributes()
     );
 
+    /// Query for a given interface id.
+    IBaseInterface* queryInterface (iid_t a_Id) override;
+
     /// Called on processing start
     void start () override;
     /// Called on processing stop
@@ -54,15 +58,19 @@ public:
     /// Processes a single audio buffer
     void process () override;
 
+    /// The output holds once the curve reaches its last event or a sustain
+    /// point, for as long as the gate holds too.
+    size_t getHoldStart (const Port* a_Output, float* a_Value) override;
+
 protected:
 
     // Event
     struct Event {
-        int32_t time;       // Time [samples]
+        int64_t time;       // Time [samples]
         float   level;      // Level
         bool    isSustain;  // True when the point is a sustain point
 
-        Event (int32_t t, const Point& p) : 
+        Event (int64_t t, const Point& p) :
             time      (t),
             level     (p.level),
             isSustain (p.isSustain)
@@ -74,31 +82,62 @@ protected:
     /// Checks if envelope points are sane. Throws an exception if they are not
     void sanityCheckPoints ();
 
-    /// Schedule envelope curve events
-    void scheduleEvents (int32_t a_Sample, bool a_Attack);
-    /// Progress to the next event
-    void nextEvent ();
+    /// Schedule envelope curve events starting at the given absolute time.
+    /// The curve continues from the current level.
+    void scheduleEvents (int64_t a_Time, bool a_Attack);
+    /// Starts the segment leading to the current event
+    void startSegment (int64_t a_Time, float a_Level);
+
+    /// Renders the envelope for buffer samples [a_Begin, a_End). The gate
+    /// does not change its state within the range.
+    void render (float* a_Out, const float* a_Gate, size_t a_Begin,
+                 size_t a_End);
+    /// Fills the output with a segment ramp starting at the given level
+    void ramp (float* a_Out, float a_Level, size_t a_Count) const;
+    /// Outputs buffer samples [a_Begin, a_Begin + a_Count) of a segment
+    /// ramp starting at the given level. At the control rate only the last
+    /// samples of sub-blocks are computed.
+    void output (float* a_Out, float a_Level, size_t a_Begin,
+                 size_t a_Count) const;
+
+    /// Returns the level of the current segment at the given absolute time
+    inline float getLevel (int64_t a_Time) const {
+        return m_SegLevel + (float)(a_Time - m_SegTime) * m_LevelDelta;
+    }
 
     /// Gate input
     Port* m_Gate;
     /// Amplitude output
     Port* m_Output;
 
+    /// Output linear gain instead of dB
+    bool  m_Linear = false;
+    /// Output at the control rate
+    bool  m_ControlRate = false;
+
     /// Envelope points
     std::vector<Point> m_Points;
 
-    /// Envelope event times. An event correspons to an envelope point
-    std::deque<Event>  m_Events;
+    /// Envelope events. An event correspons to an envelope point, event
+    /// times are absolute.
+    std::vector<Event> m_Events;
+    /// Index of the event the current segment leads to. When past the end
+    /// the level is held.
+    size_t  m_NextEvent   = 0;
+
+    /// Absolute time of the first sample of the current buffer [samples]
+    int64_t m_Time        = 0;
 
     /// Gate input state
     float   m_GateState   = 0.0f;
 
     /// Activity
     bool    m_IsActive    = false;
-    /// Current level
-    double  m_CurrLevel   = 0.0;
-    /// Level delta
-    double  m_LevelDelta  = 0.0;
+    /// Current segment start time [samples] and level
+    int64_t m_SegTime     = 0;
+    float   m_SegLevel    = 0.0f;
+    /// Level delta per sample
+    float   m_LevelDelta  = 0.0f;
 };
 
 // ============================================================================
@@ -1,8 +1,8 @@
 #include "midi_ctrl.hh"
 #include <utils/utils.hh>
+#include <audio/kernels.hh>
 
 #include <algorithm>
-#include <cassert>
 
 namespace Graph {
 namespace Modules {
@@ -13,12 +13,13 @@ MidiController::MidiController (const std::string& a_Name,
                                 const Module::Attributes& a_Attributes) :
     Module ("midiController", a_Name, a_Attributes)
 {
-    // Output port
-    m_Output = addPort(new Port(this, "out", Port::Direction::OUTPUT));
+    // Output port, control rate
+    m_Output = addPort(new Port(this, "out", Port::Direction::OUTPUT,
+        Port::Rate::CONTROL));
 
     // Attributes
     m_Controller = std::stoi(a_Attributes.get("controller", "0"));
-    m_State      = Utils::stof(a_Attributes.get("default",    "0.0f"));
+    m_Default    = Utils::stof(a_Attributes.get("default",    "0.0f"));
     m_Min        = Utils::stof(a_Attributes.get("min",        "0.0f"));
     m_Max        = Utils::stof(a_Attributes.get("max",        "1.0f"));
 }
@@ -36,105 +37,64 @@ Module* MidiController::create (
 
 IBaseInterface* MidiController::queryInterface (iid_t a_Id) {
 
-    // We have IMidiListener
-    if (a_Id == IMidiListener::ID) {
-        return static_cast<IMidiListener*>(this);
+    // We have IControllerListener
+    if (a_Id == IControllerListener::ID) {
+        return static_cast<IControllerListener*>(this);
     }
 
     return Module::queryInterface(a_Id);
 }
 
-// ============================================================================
-
-void MidiController::pushEvent (const MIDI::Event& a_Event) {
-
-    // Not active, update immediately
-    if (!m_Active) {
-        update(a_Event);
-    }
-    // Queue the event
-    else {
-        m_Events.push_back(a_Event);
-    }
+void MidiController::setControllerState (const MIDI::ControllerState* a_State) {
+    m_ControllerState = a_State;
 }
 
 // ============================================================================
 
-void MidiController::update (const MIDI::Event& a_Event) {
+float MidiController::toState (int32_t a_Value) const {
 
-    // A controller event
-    if (a_Event.type == MIDI::Event::Type::CONTROLLER) {
-
-        // We are listening for this one
-        if (a_Event.data.ctrl.param == m_Controller) {
-            float v = (float)a_Event.data.ctrl.value / 127.0f;
-            m_State = m_Min + v * (m_Max - m_Min);
-        }
+    // Not set yet
+    if (a_Value < 0) {
+        return m_Default;
     }
-}
-
-// ============================================================================
 
-void MidiController::start () {
-    m_Events.clear();
-    m_Active = true;
-}
-
-void MidiController::stop () {
-    m_Events.clear();
-    m_Active = false;
+    float v = (float)a_Value / 127.0f;
+    return m_Min + v * (m_Max - m_Min);
 }
 
 void MidiController::process () {
 
-    // Sort events by their times
-    std::sort(m_Events.begin(), m_Events.end(),
-        [](MIDI::Event const& a, MIDI::Event const& b) {
-            return a.time < b.time;
-        });
-    
     // Get data pointers
-    float* ptr   = m_Output->getBuffer().data();
-
-    size_t pos   = 0;
-    auto   evItr = m_Events.begin();
+    auto&  buffer = m_Output->getBuffer();
+    float* ptr    = buffer.data();
 
-    while (pos < m_BufferSize) {
-
-        // Get next event, determine current segment length
-        size_t length;
-        if (evItr != m_Events.end()) {
-            MIDI::Event& nextEvent = *evItr;
-            size_t sample = nextEvent.time;
+    // No controller state, output the default
+    if (m_ControllerState == nullptr) {
+        Audio::Kernels::fill(ptr, m_Default, buffer.getSize());
+        return;
+    }
 
-            assert(sample >= pos);
-            assert(sample <  m_BufferSize);
+    // Start from the value at the buffer start
+    float state = toState(m_ControllerState->getStartValue(m_Controller));
 
-            length = sample - pos;
-        }
+    auto& changes = m_ControllerState->getChanges();
+    auto  chItr   = changes.begin();
 
-        // No next event, continue to the end of the buffer
-        else {
-            length = m_BufferSize - pos;
-        }
+    // Output the state at the last sample of each sub-block
+    for (size_t j=0; j<buffer.getSize(); ++j) {
+        size_t last = std::min((j + 1) * Port::CONTROL_PERIOD, m_BufferSize) - 1;
 
-        // Fill the buffer segment with the current state.
-        for (size_t i=0; i<length; ++i) {
-            *ptr++ = m_State;
+        // Apply changes up to it
+        for (; chItr != changes.end() && (size_t)chItr->time <= last; ++chItr) {
+            if (chItr->param == m_Controller) {
+                state = toState(chItr->value);
+            }
         }
-        pos += length;
 
-        // Got a next event, update the state
-        if (evItr != m_Events.end()) {
-            update(*evItr++);
-        }
+        ptr[j] = state;
     }
-
-    // Clear the event list
-    m_Events.clear();
 }
 
-
 // ============================================================================
 
 }; // Modules
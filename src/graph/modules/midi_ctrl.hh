@@ -2,7 +2,7 @@
 #define GRAPH_MODULES_MIDI_CONTROLLER_HH
 
 #include "../module.hh"
-#include "../iface/midi_listener.hh"
+#include "../iface/controller_listener.hh"
 
 #include <utils/base_interface.hh>
 #include <audio/buffer.hh>
@@ -17,7 +17,7 @@ namespace Modules {
 
 // ============================================================================
 
-class MidiController : public Module, public IMidiListener {
+class MidiController : public Module, public IControllerListener {
 public:
 
     /// Constructor
@@ -36,24 +36,19 @@ public:
     /// Query for a given interface id.
     IBaseInterface* queryInterface (iid_t a_Id) override;
 
-    /// Updates state with an event.
-    void update  (const MIDI::Event& a_Event);
-
-    /// Called on audio processing start
-    void start   () override;
-    /// Called on audio processing stop
-    void stop    () override;
-
     /// Processes a single audio buffer
     void process () override;
 
-    /// Pushes a single event on the event list
-    void pushEvent (const MIDI::Event& a_Event) override;
+    /// Sets the controller state to read from
+    void setControllerState (const MIDI::ControllerState* a_State) override;
 
 protected:
 
-    /// Activity flag
-    bool m_Active = false;
+    /// Converts a controller value to the output state
+    float toState (int32_t a_Value) const;
+
+    /// Shared controller state or nullptr
+    const MIDI::ControllerState* m_ControllerState = nullptr;
 
     /// Controller id
     uint32_t m_Controller;
@@ -65,11 +60,8 @@ protected:
 
     /// Control output
     Port* m_Output;
-    /// Output state
-    float m_State;
-
-    /// Event list
-    std::vector<MIDI::Event> m_Events;
+    /// Output state when the controller has not been set
+    float m_Default;
 };
 
 // ============================================================================
@@ -47,6 +47,11 @@ MidiSource::MidiSource (const std::string& a_Name,
         m_MaxNote = (size_t)note;
     }
 
+    m_Parameters.set("glide", Parameter(0.0f, 0.0f, 2.0f, 0.01f, "Glide time [s]"));
+
+    // Apply overrides
+    applyParameterOverrides(a_Attributes);
+
     // Reset state
     reset();
 }
@@ -68,6 +73,10 @@ IBaseInterface* MidiSource::queryInterface (iid_t a_Id) {
     if (a_Id == IMidiListener::ID) {
         return static_cast<IMidiListener*>(this);
     }
+    // We have IHoldReporter
+    if (a_Id == IHoldReporter::ID) {
+        return static_cast<IHoldReporter*>(this);
+    }
 
     return Module::queryInterface(a_Id);
 }
@@ -83,6 +92,12 @@ void MidiSource::reset() {
     m_State.cv       = 0.0f;
     m_State.velocity = 0.0f;
     m_State.gate     = 0.0f;
+
+    m_HasNote   = false;
+    m_GlideLeft = 0;
+
+    m_HoldStart   = 0;
+    m_CvHoldStart = 0;
 }
 
 void MidiSource::pushEvent (const MIDI::Event& a_Event) {
@@ -104,7 +119,31 @@ void MidiSource::pushEvent (const MIDI::Event& a_Event) {
 
 // ============================================================================
 
+size_t MidiSource::getHoldStart (const Port* a_Output, float* a_Value) {
+
+    if (a_Output == m_Gate) {
+        *a_Value = m_State.gate;
+        return m_HoldStart;
+    }
+    if (a_Output == m_Velocity) {
+        *a_Value = m_State.velocity;
+        return m_HoldStart;
+    }
+    if (a_Output == m_Note && m_GlideLeft == 0) {
+        *a_Value = m_State.cv;
+        return m_CvHoldStart;
+    }
+
+    return NONE;
+}
+
+// ============================================================================
+
 void MidiSource::start () {
+
+    // Call the base method
+    Module::start();
+
     reset();
 }
 
@@ -124,6 +163,9 @@ void MidiSource::process () {
     size_t pos   = 0;
     auto   evItr = m_Events.begin();
 
+    m_HoldStart   = m_Events.empty() ? 0 : m_Events.back().time;
+    m_CvHoldStart = m_HoldStart;
+
     while (pos < m_BufferSize) {
 
         // Get next event, determine current segment length
@@ -143,8 +185,18 @@ void MidiSource::process () {
             length = m_BufferSize - pos;
         }
 
-        // Fill the buffer segment with the current state.
+        // Fill the buffer segment with the current state, glide the CV
+        // towards the target if needed.
         for (size_t i=0; i<length; ++i) {
+            if (m_GlideLeft != 0) {
+                if (--m_GlideLeft != 0) {
+                    m_State.cv   += m_GlideStep;
+                } else {
+                    m_State.cv    = m_GlideTarget;
+                    m_CvHoldStart = std::max(m_CvHoldStart, pos + i);
+                }
+            }
+
             *ptrCv++       = m_State.cv;
             *ptrVelocity++ = m_State.velocity;
             *ptrGate++     = m_State.gate;
@@ -156,7 +208,21 @@ void MidiSource::process () {
             MIDI::Event& event = *evItr++;
 
             if (event.type == MIDI::Event::Type::NOTE_ON) {
-                m_State.cv       = Utils::noteToCv(event.data.note.note);
+                float cv    = Utils::noteToCv(event.data.note.note);
+                float glide = m_Parameters.get("glide").get().asNumber();
+
+                // Glide from the previous note
+                m_GlideLeft = (m_HasNote) ?
+                    (size_t)(glide * m_SampleRate + 0.5f) : 0;
+
+                if (m_GlideLeft != 0) {
+                    m_GlideTarget = cv;
+                    m_GlideStep   = (cv - m_State.cv) / (float)m_GlideLeft;
+                } else {
+                    m_State.cv    = cv;
+                }
+
+                m_HasNote        = true;
                 m_State.velocity = (float)event.data.note.velocity[0] / 127.0f;
                 m_State.gate     = 1.0f;
             }
@@ -3,6 +3,7 @@
 
 #include "../module.hh"
 #include "../iface/midi_listener.hh"
+#include "../iface/hold_reporter.hh"
 
 #include <utils/base_interface.hh>
 #include <audio/buffer.hh>
@@ -17,7 +18,7 @@ namespace Modules {
 
 // ============================================================================
 
-class MidiSource : public Module, public IMidiListener {
+class MidiSource : public Module, public IMidiListener, public IHoldReporter {
 public:
 
     /// Constructor
@@ -45,6 +46,10 @@ public:
     /// Pushes a single event on the event list
     void pushEvent (const MIDI::Event& a_Event) override;
 
+    /// Outputs only change on events, they hold from the last one or from
+    /// the end of a glide.
+    size_t getHoldStart (const Port* a_Output, float* a_Value) override;
+
 protected:
 
     /// Resets state
@@ -69,6 +74,20 @@ protected:
         float gate;
     } m_State;
 
+    /// Set once a note has been played since the start
+    bool   m_HasNote = false;
+    /// Glide target CV
+    float  m_GlideTarget = 0.0f;
+    /// Glide CV increment per sample
+    float  m_GlideStep = 0.0f;
+    /// Remaining glide length [samples]
+    size_t m_GlideLeft = 0;
+
+    /// Sample of the last processed buffer from which the state holds
+    size_t m_HoldStart   = 0;
+    /// Same for the CV which may still glide after the last event
+    size_t m_CvHoldStart = 0;
+
     /// Event list
     std::vector<MIDI::Event> m_Events;
 };
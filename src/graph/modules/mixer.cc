@@ -1,5 +1,6 @@
 #include "mixer.hh"
 #include <utils/math.hh>
+#include <audio/kernels.hh>
 
 #include <stringf.hh>
 
@@ -62,31 +63,52 @@ void Mixer::prepare (float a_SampleRate, size_t a_BufferSize) {
             m_Gain[i]->setLock(true);
         }
     }
+
+    // Select the kernel
+    m_Kernel = selectKernel(a_BufferSize);
 }
 
 // ============================================================================
 
-void Mixer::process () {
+template <size_t N>
+void Mixer::processBuffer () {
 
-    // Clear output buffer
-    m_Output->getBuffer().clear();
+    const size_t size = N ? N : m_BufferSize;
 
-    // Process
+    // Clear output buffer
     float* ptrOut = m_Output->getBuffer().data();
+    Audio::Kernels::Fixed<N>::fill(ptrOut, 0.0f, size);
 
+    // Process
     for (size_t j=0; j<m_Inputs.size(); ++j) {
         float gain  = Math::log2lin(m_Gain[j]->get().asNumber());
         auto  port  = m_Inputs[j];
 
         const float* ptrIn = port->process().data();
-        for (size_t i=0; i<m_BufferSize; ++i) {
-            ptrOut[i] += (ptrIn[i] * gain);
-        }
+        Audio::Kernels::Fixed<N>::mac(ptrOut, ptrIn, gain, size);
+    }
+}
+
+Mixer::Kernel Mixer::selectKernel (size_t a_BufferSize) {
+
+    switch (getFixedKernelSize(a_BufferSize))
+    {
+    case 32:  return &Mixer::processBuffer<32>;
+    case 64:  return &Mixer::processBuffer<64>;
+    case 128: return &Mixer::processBuffer<128>;
+    case 256: return &Mixer::processBuffer<256>;
+    default:  return &Mixer::processBuffer<0>;
     }
 }
 
 // ============================================================================
 
+void Mixer::process () {
+    (this->*m_Kernel)();
+}
+
+// ============================================================================
+
 }; // Modules
 }; // Graph
 
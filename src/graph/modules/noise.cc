@@ -1,6 +1,7 @@
 #include "noise.hh"
 #include "../parameter.hh"
 #include <utils/math.hh>
+#include <audio/kernels.hh>
 
 #include <chrono>
 
@@ -23,6 +24,11 @@ Noise::Noise (const std::string& a_Name,
 
     // Parameters
     m_Parameters.set("amplitude", Parameter(-6.0, -30.0, 0.0f, 0.1f, "Amplitude [dB]"));
+    m_Parameters.set("color",     Parameter("white", {
+        "white",
+        "pink",
+        "brown"
+    }, "Noise color"));
 
     // Apply overrides
     applyParameterOverrides(a_Attributes);
@@ -39,22 +45,40 @@ Module* Noise::create (
 
 // ============================================================================
 
+void Noise::setRandomSeed (uint32_t a_Seed) {
+    m_RandomSeed    = a_Seed;
+    m_HasRandomSeed = true;
+}
+
 void Noise::start () {
 
+    // Call the base method
+    Module::start();
+
     // Initialize with the default seed
     if (m_Seed == 0) {
-        m_Gen = std::mt19937(std::mt19937::default_seed);
+        m_Gen.seed(Utils::Random::DEFAULT_SEED);
+    }
+    // Initialize with the externally provided seed
+    else if (m_Seed < 0 && m_HasRandomSeed) {
+        m_Gen.seed(m_RandomSeed);
     }
     // Initialize with the current time
     else if (m_Seed < 0) {
         auto seed = std::chrono::high_resolution_clock::now().time_since_epoch().count();
-        m_Gen = std::mt19937(seed);
+        m_Gen.seed(seed);
     }
     // Initialize with the specific seed
     else {
-        std::mt19937::result_type seed = m_Seed;
-        m_Gen = std::mt19937(seed);
+        m_Gen.seed(m_Seed);
     }
+
+    // Reset filters
+    for (auto& b : m_Pink) {
+        b = 0.0f;
+    }
+
+    m_Brown = 0.0f;
 }
 
 // ============================================================================
@@ -65,14 +89,53 @@ void Noise::process () {
     float A = m_Parameters.get("amplitude").get().asNumber();
     A = Math::log2lin(A);
 
+    // Color
+    int32_t color = m_Parameters.get("color").get().asNumber();
+
     // Get pointers
     float* ptr = m_Output->getBuffer().data();
 
     // White noise
-    for (size_t i=0; i<m_BufferSize; ++i) {
-        float r = (float)m_Gen() / (float)(1UL << 31) - 1.0f;
-        *ptr++ = A * r;
+    m_Gen.uniform(ptr, m_BufferSize);
+
+    // Pink noise. Paul Kellet's refined filter, -3dB per octave. The gain
+    // keeps the output within [-1, 1].
+    if (color == 1) {
+        float b0 = m_Pink[0], b1 = m_Pink[1], b2 = m_Pink[2], b3 = m_Pink[3];
+        float b4 = m_Pink[4], b5 = m_Pink[5], b6 = m_Pink[6];
+
+        for (size_t i=0; i<m_BufferSize; ++i) {
+            float w = ptr[i];
+
+            b0 = 0.99886f * b0 + w * 0.0555179f;
+            b1 = 0.99332f * b1 + w * 0.0750759f;
+            b2 = 0.96900f * b2 + w * 0.1538520f;
+            b3 = 0.86650f * b3 + w * 0.3104856f;
+            b4 = 0.55000f * b4 + w * 0.5329522f;
+            b5 = -0.7616f * b5 - w * 0.0168980f;
+
+            ptr[i] = 0.13f * (b0 + b1 + b2 + b3 + b4 + b5 + b6 + w * 0.5362f);
+            b6 = w * 0.115926f;
+        }
+
+        m_Pink[0] = b0; m_Pink[1] = b1; m_Pink[2] = b2; m_Pink[3] = b3;
+        m_Pink[4] = b4; m_Pink[5] = b5; m_Pink[6] = b6;
+    }
+
+    // Brown noise. Leaky integrator, -6dB per octave, same output range
+    else if (color == 2) {
+        float b = m_Brown;
+
+        for (size_t i=0; i<m_BufferSize; ++i) {
+            b = (b + 0.02f * ptr[i]) * (1.0f / 1.02f);
+            ptr[i] = 3.5f * b;
+        }
+
+        m_Brown = b;
     }
+
+    // Apply amplitude
+    Audio::Kernels::scale(ptr, A, m_BufferSize);
 }
 
 // ============================================================================
@@ -3,8 +3,9 @@
 
 #include "../module.hh"
 
+#include <utils/random.hh>
+
 #include <string>
-#include <random>
 
 #include <cstddef>
 #include <cstdint>
@@ -14,6 +15,7 @@ namespace Modules {
 
 // ============================================================================
 
+/// A noise source. Generates white, pink or brown noise.
 class Noise : public Module {
 public:
 
@@ -30,6 +32,10 @@ public:
         const Module::Attributes& a_Attributes = Module::Attributes()
     );
 
+    /// Sets a reproducible seed used instead of the timestamp when the
+    /// "seed" attribute is negative
+    virtual void setRandomSeed (uint32_t a_Seed) override;
+
     /// Called on processing start
     virtual void start () override;
 
@@ -39,10 +45,20 @@ public:
 protected:
 
     /// Random number generator
-    std::mt19937 m_Gen;
+    Utils::Random m_Gen;
     /// Random generator seed. If set to -1 then the current timestamp is used
     int32_t      m_Seed = -1;
 
+    /// Pink noise filter state
+    float        m_Pink[7];
+    /// Brown noise integrator state
+    float        m_Brown;
+
+    /// Reproducible seed set externally
+    uint32_t     m_RandomSeed    = 0;
+    /// True when the reproducible seed has been set
+    bool         m_HasRandomSeed = false;
+
     /// Output port
     Port* m_Output;
 };
@@ -0,0 +1,211 @@
+#include "../exception.hh"
+
+#include "oversampler.hh"
+
+#include <utils/exception.hh>
+#include <stringf.hh>
+
+namespace Graph {
+namespace Modules {
+
+// ============================================================================
+
+namespace {
+
+/// Filter order of the stage at the lower rate. Determines the passband of
+/// the whole chain.
+constexpr size_t FIRST_STAGE_ORDER = 31;
+/// Filter order of further stages. These only need to preserve the band
+/// passed by the first one so they can have a wide transition band.
+constexpr size_t OTHER_STAGE_ORDER = 11;
+
+}; // Anonymous
+
+// ============================================================================
+
+Oversampler::Oversampler (const std::string& a_Type,
+                          const std::string& a_Name,
+                          size_t a_Factor,
+                          const Module::Attributes& a_Attributes) :
+    Module   (a_Type, a_Name, a_Attributes),
+    m_Factor (a_Factor)
+{
+    if (a_Factor != 2 && a_Factor != 4 && a_Factor != 8) {
+        THROW(BuildError, "Invalid oversampling factor %zu, must be 2, 4 or 8",
+            a_Factor
+        );
+    }
+}
+
+// ============================================================================
+
+void Oversampler::addBoundaryPort (const std::string& a_Name,
+                                   Port::Direction a_Direction)
+{
+    Boundary boundary;
+
+    // The outer port of an input is a proxy to the outside, the inner one
+    // holds the upsampled signal. Make the inner port a sink of the outer one
+    // so that the upstream module sees its output as connected.
+    if (a_Direction == Port::Direction::INPUT) {
+        boundary.outer = addPort(new Port(this, a_Name,
+            Port::Direction::INPUT, 0.0f));
+        boundary.inner = addPort(new Port(this, a_Name + "#inner",
+            Port::Direction::INPUT));
+
+        m_Connections.set(boundary.inner, boundary.outer);
+    }
+
+    // The inner port of an output is a proxy to a submodule output, the outer
+    // one holds the downsampled signal. The inner port is an input so that
+    // marking the outer one dirty propagates to submodules.
+    else {
+        boundary.outer = addPort(new Port(this, a_Name,
+            Port::Direction::OUTPUT));
+        boundary.inner = addPort(new Port(this, a_Name + "#inner",
+            Port::Direction::INPUT, 0.0f));
+
+        m_Connections.set(boundary.outer, boundary.inner);
+    }
+
+    // Filters
+    boundary.stages.push_back(Processing::HalfBand(FIRST_STAGE_ORDER));
+    for (size_t f=4; f<=m_Factor; f *= 2) {
+        boundary.stages.push_back(Processing::HalfBand(OTHER_STAGE_ORDER));
+    }
+
+    if (a_Direction == Port::Direction::INPUT) {
+        m_Inputs.push_back(boundary);
+    } else {
+        m_Outputs.push_back(boundary);
+    }
+}
+
+Port* Oversampler::getInnerPort (const std::string& a_Name) {
+    return getPort(a_Name + "#inner");
+}
+
+// ============================================================================
+
+void Oversampler::prepare (float a_SampleRate, size_t a_BufferSize) {
+
+    // Store parameters
+    m_SampleRate = a_SampleRate;
+    m_BufferSize = a_BufferSize;
+
+    // Prepare ports and filters. Stage s runs at 2^s times the sample rate
+    // on its lower rate side.
+    for (auto list : {&m_Inputs, &m_Outputs}) {
+        for (auto& boundary : *list) {
+            preparePort(boundary.outer, a_BufferSize);
+            preparePort(boundary.inner, a_BufferSize * m_Factor);
+
+            for (size_t s=0; s<boundary.stages.size(); ++s) {
+                boundary.stages[s].prepare(a_BufferSize << s);
+            }
+        }
+    }
+
+    // Scratch buffers
+    for (auto& buffer : m_Scratch) {
+        buffer.create(a_BufferSize * m_Factor);
+    }
+
+    // Prepare submodules at the higher rate
+    for (auto& it : m_Submodules) {
+        auto child = it.second;
+        child->prepare(a_SampleRate * m_Factor, a_BufferSize * m_Factor);
+    }
+}
+
+void Oversampler::start () {
+
+    // Call the base method
+    Module::start();
+
+    // Reset filters
+    for (auto list : {&m_Inputs, &m_Outputs}) {
+        for (auto& boundary : *list) {
+            for (auto& stage : boundary.stages) {
+                stage.reset();
+            }
+        }
+    }
+}
+
+// ============================================================================
+
+void Oversampler::process () {
+
+    const size_t stages = m_Inputs.empty() && m_Outputs.empty() ? 0 :
+        (m_Inputs.empty() ? m_Outputs : m_Inputs).front().stages.size();
+
+    // Upsample inputs, from the lower rate up
+    for (auto& boundary : m_Inputs) {
+
+        // Nothing inside uses it
+        if (!boundary.inner->isConnected()) {
+            continue;
+        }
+
+        const float* src = boundary.outer->process().data();
+        float*       dst = boundary.inner->getBuffer().data();
+        size_t     count = m_BufferSize;
+
+        for (size_t s=0; s<stages; ++s) {
+            float* out = (s == stages - 1) ? dst : m_Scratch[s & 1].data();
+            boundary.stages[s].interpolate(src, out, count);
+
+            src    = out;
+            count *= 2;
+        }
+
+        boundary.inner->clearDirty();
+    }
+
+    // Downsample outputs, from the higher rate down
+    for (auto& boundary : m_Outputs) {
+
+        const float* src = boundary.inner->process().data();
+        float*       dst = boundary.outer->getBuffer().data();
+        size_t     count = m_BufferSize * m_Factor / 2;
+
+        for (size_t s=stages; s-->0; ) {
+            float* out = (s == 0) ? dst : m_Scratch[s & 1].data();
+            boundary.stages[s].decimate(src, out, count);
+
+            src    = out;
+            count /= 2;
+        }
+    }
+
+    // Clear dirty flags on all output ports
+    for (auto& boundary : m_Outputs) {
+        boundary.outer->clearDirty();
+    }
+}
+
+// ============================================================================
+
+size_t Oversampler::getMemoryUsage () const {
+    size_t size = Module::getMemoryUsage();
+
+    for (auto& buffer : m_Scratch) {
+        size += buffer.getSize() * sizeof(float);
+    }
+
+    for (auto list : {&m_Inputs, &m_Outputs}) {
+        for (auto& boundary : *list) {
+            for (auto& stage : boundary.stages) {
+                size += stage.getMemoryUsage();
+            }
+        }
+    }
+
+    return size;
+}
+
+// ============================================================================
+
+}; // Modules
+}; // Graph
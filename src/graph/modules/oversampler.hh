@@ -0,0 +1,79 @@
+#ifndef GRAPH_MODULES_OVERSAMPLER_HH
+#define GRAPH_MODULES_OVERSAMPLER_HH
+
+#include "../module.hh"
+#include "../processing/half_band.hh"
+
+#include <audio/buffer.hh>
+
+#include <string>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Graph {
+namespace Modules {
+
+// ============================================================================
+
+/// A container that runs its submodules at a multiple of the sample rate.
+/// Signals entering it are upsampled and signals leaving it are downsampled
+/// using cascaded half-band filters. Each top-level port has an inner
+/// counterpart that submodules connect to and that runs at the higher rate.
+/// Created by the builder for module definitions with the "oversample"
+/// attribute.
+class Oversampler : public Module {
+public:
+
+    /// Constructor. The factor must be 2, 4 or 8.
+    Oversampler (
+        const std::string& a_Type,
+        const std::string& a_Name,
+        size_t a_Factor,
+        const Module::Attributes& a_Attributes = Module::Attributes()
+    );
+
+    /// Adds a top-level port along with its inner counterpart
+    void addBoundaryPort (const std::string& a_Name, Port::Direction a_Direction);
+    /// Returns the inner counterpart of a top-level port
+    Port* getInnerPort (const std::string& a_Name);
+
+    /// Called on the graph initialization
+    void prepare (float a_SampleRate, size_t a_BufferSize) override;
+    /// Called on processing start
+    void start   () override;
+
+    /// Processes a single audio buffer
+    void process () override;
+
+    /// Returns an estimate of the memory used by buffers
+    size_t getMemoryUsage () const override;
+
+protected:
+
+    /// A signal crossing the boundary
+    struct Boundary {
+        Port* outer;        /// Top-level port
+        Port* inner;        /// Inner port running at the higher rate
+        /// Filters, one per octave, from the lower rate up
+        std::vector<Processing::HalfBand> stages;
+    };
+
+    /// Oversampling factor
+    size_t m_Factor;
+
+    /// Inputs and outputs
+    std::vector<Boundary> m_Inputs;
+    std::vector<Boundary> m_Outputs;
+
+    /// Scratch buffers for intermediate rates
+    Audio::Buffer<float> m_Scratch[2];
+};
+
+// ============================================================================
+
+}; // Modules
+}; // Graph
+
+#endif // GRAPH_MODULES_OVERSAMPLER_HH
@@ -4,11 +4,16 @@
 
 #include "sampler.hh"
 
+#include <strutils.hh>
 #include <utils/utils.hh>
 #include <utils/exception.hh>
 #include <utils/math.hh>
+#include <audio/kernels.hh>
 #include <stringf.hh>
 
+#include <algorithm>
+#include <map>
+#include <regex>
 #include <cmath>
 
 namespace Graph {
@@ -16,26 +21,76 @@ namespace Modules {
 
 // ============================================================================
 
+namespace {
+
+/// Parses a note given either as a MIDI note number or in english notation
+int32_t parseNote (const std::string& a_Note) {
+    int32_t note = Utils::noteToIndex(a_Note);
+    if (note != -1) {
+        return note;
+    }
+    return std::stoi(a_Note);
+}
+
+}; // Anonymous
+
+// ============================================================================
+
 Sampler::Sampler (const std::string& a_Name,
                   const Module::Attributes& a_Attributes) :
     Module ("sampler", a_Name, a_Attributes)
 {
-    // Throw an error if a waveform file is not specified
-    if (!a_Attributes.has("file")) {
-        THROW(ModuleError, "No 'file' attribute for sampler");
+    // Parse attributes to get zones, order them by number
+    std::map<int32_t, std::string> specs;
+
+    std::regex expr("zone([0-9]+)");
+    for (auto it : a_Attributes) {
+        auto& name  = it.first;
+        auto& value = it.second;
+
+        // Check if it is a zone definition
+        std::smatch match;
+        std::regex_match(name, match, expr);
+
+        if (match.empty()) {
+            continue;
+        }
+
+        specs[std::stoi(match[1])] = value;
+    }
+
+    for (auto& it : specs) {
+        m_Zones.push_back(parseZone(it.second));
     }
 
-    // Base frequency (note) of the sample waveform
-    m_BaseFreq = Utils::noteToFrequency(a_Attributes.get("note", "C4"));
+    // A single waveform looped over the whole keyboard. Used as the last
+    // resort when zones are defined as well.
+    if (a_Attributes.has("file")) {
+        Zone zone;
+        zone.minNote     = 0;
+        zone.maxNote     = 127;
+        zone.minVelocity = 0;
+        zone.maxVelocity = 127;
+
+        zone.baseFreq = Utils::noteToFrequency(a_Attributes.get("note", "C4"));
+        zone.sampler  = Processing::Sampler::get(a_Attributes.get("file"), true);
+
+        m_Zones.push_back(zone);
+    }
 
-    // Load the waveform
-    m_Sampler.load(a_Attributes.get("file"));
+    // Throw an error if no waveform file is specified
+    if (m_Zones.empty()) {
+        THROW(ModuleError, "No 'file' nor 'zone' attributes for sampler");
+    }
 
     // Input ports
     m_CvIn = addPort(new Port(this, "cv" , Port::Direction::INPUT, 0.0f));
     m_AmIn = addPort(new Port(this, "am" , Port::Direction::INPUT, 0.0f));
     m_FmIn = addPort(new Port(this, "fm" , Port::Direction::INPUT, 0.0f));
 
+    m_GateIn     = addPort(new Port(this, "gate",     Port::Direction::INPUT, 0.0f));
+    m_VelocityIn = addPort(new Port(this, "velocity", Port::Direction::INPUT, 1.0f));
+
     // Output ports
     m_Output = addPort(new Port(this, "out", Port::Direction::OUTPUT));
 
@@ -58,6 +113,60 @@ Module* Sampler::create (
 
 // ============================================================================
 
+Sampler::Zone Sampler::parseZone (const std::string& a_Spec) {
+
+    // Decode fields
+    const auto fields = strutils::split(a_Spec, ",");
+    if (fields.size() != 6 && fields.size() != 8) {
+        THROW(ModuleError,
+            "Incorrect sampler zone specification: '%s'", a_Spec.c_str());
+    }
+
+    Zone zone;
+    zone.minNote     = parseNote(fields[0]);
+    zone.maxNote     = parseNote(fields[1]);
+    zone.minVelocity = std::stoi(fields[2]);
+    zone.maxVelocity = std::stoi(fields[3]);
+
+    zone.baseFreq = Utils::noteToFrequency(parseNote(fields[5]));
+
+    // Loop points. The waveform data is laid out for them.
+    bool    loop      = (fields.size() == 8);
+    int32_t loopStart = 0;
+    int32_t loopEnd   = 0;
+
+    if (loop) {
+        loopStart = std::stoi(fields[6]);
+        loopEnd   = std::stoi(fields[7]);
+
+        if (loopStart < 0 || loopEnd <= loopStart) {
+            THROW(ModuleError,
+                "Invalid sampler zone loop points: '%s'", a_Spec.c_str());
+        }
+    }
+
+    zone.sampler = Processing::Sampler::get(fields[4], loop,
+                                            loopStart, loopEnd);
+    return zone;
+}
+
+const Sampler::Zone* Sampler::findZone (int32_t a_Note,
+                                        int32_t a_Velocity) const
+{
+    // The first matching zone wins
+    for (auto& zone : m_Zones) {
+        if (a_Note     >= zone.minNote     && a_Note     <= zone.maxNote &&
+            a_Velocity >= zone.minVelocity && a_Velocity <= zone.maxVelocity)
+        {
+            return &zone;
+        }
+    }
+
+    return nullptr;
+}
+
+// ============================================================================
+
 void Sampler::prepare (float a_SampleRate, size_t a_BufferSize) {
 
     // Call the base method
@@ -70,62 +179,158 @@ void Sampler::prepare (float a_SampleRate, size_t a_BufferSize) {
     if (!m_FmIn->isConnected()) {
         m_Parameters.get("fmGain").setLock(true);
     }
+
+    // Allocate position buffers
+    m_Index.create(a_BufferSize);
+    m_Frac.create(a_BufferSize);
 }
 
 void Sampler::start () {
-    m_Phase = 0.0f;
+
+    // Call the base method
+    Module::start();
+
+    m_Position  = 0.0;
+    m_GateState = 0.0f;
+
+    // Without a gate there are no note-on events, play the first zone
+    m_Zone = m_GateIn->isConnected() ? nullptr : &m_Zones.front();
 }
 
 // ============================================================================
 
-void Sampler::process () {
+void Sampler::render (size_t a_Begin, size_t a_End, float a_Amplitude) {
 
-    // Scaling factor - HZ to cycles
-    const float k = 1.0f / (m_SampleRate * m_BaseFreq * m_Sampler.getLength());
+    float*       ptrOut  = m_Output->getBuffer().data();
+    const float* ptrAmIn = m_AmIn->process().data();
+    const float* ptrFmIn = m_FmIn->process().data();
 
-    // Amplitude
-    float A = m_Parameters.get("amplitude").get().asNumber();
-    A = Utils::Math::log2lin(A);
+    // No zone, silence
+    if (m_Zone == nullptr) {
+        Audio::Kernels::fill(ptrOut + a_Begin, 0.0f, a_End - a_Begin);
+        return;
+    }
 
     // Amplitude modulation index
     float alpha = m_Parameters.get("amGain").get().asNumber();
     // Frequency modulation index
     float beta  = m_Parameters.get("fmGain").get().asNumber();
 
+    // Scaling factor - Hz to waveform samples
+    const auto&  sampler = *m_Zone->sampler;
+    const double k       = sampler.getSampleRate() /
+                           (m_SampleRate * m_Zone->baseFreq);
+    const double size    = (double)sampler.getSize();
+
+    const bool   loop      = sampler.isLooped();
+    const double loopStart = (double)sampler.getLoopStart();
+    const double loopEnd   = (double)sampler.getLoopEnd();
+
+    int32_t* ptrIndex = m_Index.data();
+    float*   ptrFrac  = m_Frac.data();
+
+    // Advance the position
+    double pos     = m_Position;
+    float  maxStep = 0.0f;
+
+    size_t i = a_Begin;
+    for (; i<a_End; ++i) {
+
+        // End of a non-looped waveform
+        if (pos >= size) {
+            break;
+        }
+
+        int32_t j   = (int32_t)pos;
+        ptrIndex[i] = j;
+        ptrFrac[i]  = (float)(pos - (double)j);
+
+        // Get frequency, add FM modulation
+        float f = ptrOut[i] * (1.0f + beta * ptrFmIn[i]);
+
+        float step = f * (float)k;
+        maxStep = std::max(maxStep, fabsf(step));
+
+        pos += step;
+        if (pos < 0.0) {
+            pos = 0.0;
+        }
+
+        // Loop
+        if (loop) {
+            while (pos >= loopEnd) {
+                pos -= loopEnd - loopStart;
+            }
+        }
+    }
+
+    m_Position = pos;
+
+    // Compute gain with AM modulation, silence past the end
+    size_t count = i - a_Begin;
+    for (size_t j=a_Begin; j<i; ++j) {
+        ptrOut[j] = a_Amplitude * (1.0f + alpha * ptrAmIn[j]);
+    }
+
+    Audio::Kernels::fill(ptrOut + i, 0.0f, a_End - i);
+
+    // Render the waveform using the level that is alias-free for the highest
+    // frequency in the span
+    size_t level = sampler.getLevel(maxStep);
+    sampler.render(level, ptrIndex + a_Begin, ptrFrac + a_Begin,
+                   ptrOut + a_Begin, ptrOut + a_Begin, count);
+}
+
+void Sampler::process () {
+
+    // Amplitude
+    float A = m_Parameters.get("amplitude").get().asNumber();
+    A = Utils::Math::log2lin(A);
+
     // Get pointers
-    float* ptrOut         = m_Output->getBuffer().data();
-    const float* ptrCvIn  = m_CvIn->process().data();
-    const float* ptrAmIn  = m_AmIn->process().data();
-    const float* ptrFmIn  = m_FmIn->process().data();
+    float*       ptrOut        = m_Output->getBuffer().data();
+    const float* ptrCvIn       = m_CvIn->process().data();
+    const float* ptrGateIn     = m_GateIn->process().data();
+    const float* ptrVelocityIn = m_VelocityIn->process().data();
 
-    // Generate the wave
-    float phi = m_Phase;
-    for (size_t i=0; i<m_BufferSize; ++i) {
+    // Convert CV to frequency for the whole block. Use the output buffer as
+    // temporary storage.
+    Utils::Math::cvToFrequency(ptrOut, ptrCvIn, m_BufferSize);
 
-        // Add AM modulation
-        float am = *ptrAmIn++;
-        float a  = A * (1.0f + alpha * am);        
+    // Render spans in between note-on events
+    size_t begin = 0;
+    for (size_t i=0; i<m_BufferSize; ++i) {
+        float gate  = ptrGateIn[i];
+        float delta = gate - m_GateState;
+        m_GateState = gate;
 
-        // Convert CV to frequency
-        float f = Utils::cvToFrequency(*ptrCvIn++);
+        if (delta <= 0.5f) {
+            continue;
+        }
 
-        // Add FM modulation
-        float fm = *ptrFmIn++;
-        f *= (1.0f + beta * fm);
+        render(begin, i, A);
+        begin = i;
 
-        // Generate the waveform
-        *ptrOut++ = a * m_Sampler.getSample(phi);
+        // Select the zone and restart
+        int32_t note     = (int32_t)lroundf(ptrCvIn[i] * 12.0f) + 21;
+        int32_t velocity = (int32_t)lroundf(ptrVelocityIn[i] * 127.0f);
 
-        // Accumulate phase
-        phi += f * k;
-        while (phi > 1.0f) phi -= 1.0f;
+        m_Zone     = findZone(note, velocity);
+        m_Position = 0.0;
     }
 
-    m_Phase = phi;
+    render(begin, m_BufferSize, A);
+}
+
+// ============================================================================
+
+size_t Sampler::getMemoryUsage () const {
+    return Module::getMemoryUsage() +
+        m_Index.getSize() * sizeof(int32_t) +
+        m_Frac .getSize() * sizeof(float);
 }
 
 // ============================================================================
 
 }; // Modules
 }; // Graph
-
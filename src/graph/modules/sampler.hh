@@ -4,7 +4,11 @@
 #include "../module.hh"
 #include "../processing/sampler.hh"
 
+#include <audio/buffer.hh>
+
 #include <string>
+#include <vector>
+#include <memory>
 
 #include <cstddef>
 #include <cstdint>
@@ -38,14 +42,49 @@ public:
     /// Processes a single audio buffer
     virtual void process () override;
 
+    /// Returns an estimate of the memory used by buffers. Tables shared by
+    /// all instances are not included.
+    size_t getMemoryUsage () const override;
+
 protected:
 
-    /// Sampler
-    Graph::Processing::Sampler m_Sampler;
-    /// Base frequency
-    float m_BaseFreq;
-    /// Current phase accumulator
-    float m_Phase = 0.0f;
+    /// A sample zone. Maps a note and velocity range to a waveform.
+    struct Zone {
+        int32_t minNote;        /// Lowest note (MIDI)
+        int32_t maxNote;        /// Highest note (MIDI)
+        int32_t minVelocity;    /// Lowest velocity (0-127)
+        int32_t maxVelocity;    /// Highest velocity (0-127)
+
+        float   baseFreq;       /// Frequency of the waveform at original rate
+
+        /// Shared waveform data laid out for the loop of the zone
+        std::shared_ptr<const Graph::Processing::Sampler> sampler;
+    };
+
+    /// Parses a zone specification
+    static Zone parseZone (const std::string& a_Spec);
+
+    /// Selects a zone for the given note and velocity, returns nullptr if
+    /// there is none.
+    const Zone* findZone (int32_t a_Note, int32_t a_Velocity) const;
+
+    /// Renders buffer samples [a_Begin, a_End) using the current zone. The
+    /// output holds frequencies [Hz] on entry.
+    void render (size_t a_Begin, size_t a_End, float a_Amplitude);
+
+    /// Zones
+    std::vector<Zone> m_Zones;
+
+    /// Current zone
+    const Zone* m_Zone = nullptr;
+    /// Current position within the waveform [samples]
+    double m_Position  = 0.0;
+    /// Gate input state
+    float  m_GateState = 0.0f;
+
+    /// Per-sample waveform position buffers
+    Audio::Buffer<int32_t> m_Index;
+    Audio::Buffer<float>   m_Frac;
 
     /// Frequency (CV) input
     Port*  m_CvIn;
@@ -53,6 +92,10 @@ protected:
     Port*  m_AmIn;
     /// FM input
     Port*  m_FmIn;
+    /// Gate input
+    Port*  m_GateIn;
+    /// Velocity input
+    Port*  m_VelocityIn;
 
     /// Output
     Port* m_Output;
@@ -64,4 +107,3 @@ protected:
 }; // Graph
 
 #endif // GRAPH_MODULES_SAMPLER_HH
-
@@ -54,15 +54,12 @@ void SoftClipper::process () {
     const float* ptrLevel = m_Level->process().data();
     float*       ptrOut   = m_Output->getBuffer().data();
 
-    // Process
-    for (size_t i=0; i<m_BufferSize; ++i) {
-
-        // Get clipping level and convert to linear scale
-        float level = *ptrLevel++;
-        level = Math::log2lin(level);
+    // Convert clipping levels to linear scale for the whole block
+    Math::log2lin(ptrOut, ptrLevel, m_BufferSize);
 
-        // Do the clipping
-        *ptrOut++ = softClip(*ptrIn++, level);
+    // Do the clipping
+    for (size_t i=0; i<m_BufferSize; ++i) {
+        ptrOut[i] = softClip(ptrIn[i], ptrOut[i]);
     }
 }
 
@@ -0,0 +1,302 @@
+#include "../exception.hh"
+
+#include "svf.hh"
+
+#include <utils/utils.hh>
+#include <utils/math.hh>
+#include <utils/exception.hh>
+#include <stringf.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Graph {
+namespace Modules {
+
+// ============================================================================
+
+SVF::SVF (const std::string& a_Name,
+          const Module::Attributes& a_Attributes) :
+    Module ("svf", a_Name, a_Attributes)
+{
+    // Coefficient update interval
+    int interval = std::stoi(a_Attributes.get("controlInterval", "1"));
+    if (interval < 1) {
+        THROW(BuildError, "Invalid control interval %d", interval);
+    }
+
+    m_ControlInterval = interval;
+
+    // Control inputs are only sampled at interval ends. When these align
+    // with control rate sub-blocks take them at the control rate.
+    Port::Rate rate = Port::Rate::AUDIO;
+    if (m_ControlInterval % Port::CONTROL_PERIOD == 0) {
+        rate = Port::Rate::CONTROL;
+        m_ControlDivider = Port::CONTROL_PERIOD;
+    }
+
+    // Input ports
+    m_Input = addPort(new Port(this, "in",   Port::Direction::INPUT, 0.0f));
+    m_Freq  = addPort(new Port(this, "freq", Port::Direction::INPUT, 0.0f, rate));
+    m_Q     = addPort(new Port(this, "q",    Port::Direction::INPUT, 0.7071f, rate));
+
+    // Output ports
+    m_Lp    = addPort(new Port(this, "lp",   Port::Direction::OUTPUT));
+    m_Bp    = addPort(new Port(this, "bp",   Port::Direction::OUTPUT));
+    m_Hp    = addPort(new Port(this, "hp",   Port::Direction::OUTPUT));
+
+    // Pole count
+    int poles = std::stoi(a_Attributes.get("poles", "2"));
+    if (poles != 2 && poles != 4 && poles != 8) {
+        THROW(BuildError, "Invalid pole count %d, must be 2, 4 or 8", poles);
+    }
+
+    m_Stages = poles / 2;
+
+    // Apply overrides
+    applyParameterOverrides(a_Attributes);
+}
+
+Module* SVF::create (
+    const std::string& a_Type,
+    const std::string& a_Name,
+    const Module::Attributes& a_Attributes)
+{
+    (void)a_Type;
+    return new SVF(a_Name, a_Attributes);
+}
+
+// ============================================================================
+
+void SVF::prepare (float a_SampleRate, size_t a_BufferSize) {
+
+    // Call the base method
+    Module::prepare(a_SampleRate, a_BufferSize);
+
+    // Compute only the connected outputs
+    m_Kernel = selectKernel(
+        m_Lp->isConnected(),
+        m_Bp->isConnected(),
+        m_Hp->isConnected()
+    );
+}
+
+void SVF::start () {
+
+    // Call the base method
+    Module::start();
+
+    // Reset state
+    m_InputState.valid = false;
+    m_InputState.cv    = 0.0f;
+    m_InputState.q     = 0.0f;
+
+    for (auto& states : m_States) {
+        for (auto& state : states) {
+            state = Processing::SVF::State();
+        }
+    }
+}
+
+// ============================================================================
+
+void SVF::computeCoeffs (float a_Cv, float a_Q,
+                         Processing::SVF::Coeffs* a_Coeffs) const
+{
+    float f = Utils::Math::fastCvToFrequency(a_Cv);
+
+    // Limit
+    if (a_Q <  0.1f) a_Q =  0.1f;
+    if (a_Q > 20.0f) a_Q = 20.0f;
+
+    // The Q input scales Butterworth Qs of all stages so that the default
+    // value gives a maximally flat response.
+    float scale = a_Q / Processing::SVF::getButterworthQ(1, 0);
+
+    for (size_t s=0; s<m_Stages; ++s) {
+        float q = scale * Processing::SVF::getButterworthQ(m_Stages, s);
+        a_Coeffs[s] = Processing::SVF::compute(f, q, m_SampleRate);
+    }
+}
+
+// ============================================================================
+
+template <size_t STAGES, bool LP, bool BP, bool HP>
+void SVF::processCascade () {
+
+    using Processing::SVF;
+
+    // Get pointers
+    const float* ptrIn   = m_Input->process().data();
+    const float* ptrFreq = m_Freq->process().data();
+    const float* ptrQ    = m_Q->process().data();
+
+    float* ptrLp = LP ? m_Lp->getBuffer().data() : nullptr;
+    float* ptrBp = BP ? m_Bp->getBuffer().data() : nullptr;
+    float* ptrHp = HP ? m_Hp->getBuffer().data() : nullptr;
+
+    // Local copies, kept in registers
+    SVF::Coeffs c  [STAGES];
+    SVF::Coeffs dc [STAGES];
+    SVF::State  lp [STAGES];
+    SVF::State  bp [STAGES];
+    SVF::State  hp [STAGES];
+
+    for (size_t s=0; s<STAGES; ++s) {
+        c [s] = m_Coeffs[s];
+        lp[s] = m_States[0][s];
+        bp[s] = m_States[1][s];
+        hp[s] = m_States[2][s];
+    }
+
+    size_t i = 0;
+    while (i < m_BufferSize) {
+
+        // Process up to the next control point
+        size_t count = std::min(m_ControlInterval, m_BufferSize - i);
+        size_t last  = i + count - 1;
+
+        // Get control state at the end of the interval
+        size_t ctrl = last / m_ControlDivider;
+        float  cv   = ptrFreq[ctrl];
+        float  q    = ptrQ[ctrl];
+
+        // Something changed, recompute and ramp the coefficients over the
+        // interval.
+        SVF::Coeffs target [STAGES];
+        bool changed = !m_InputState.valid  ||
+                        m_InputState.cv != cv ||
+                        m_InputState.q  != q;
+
+        if (changed) {
+            computeCoeffs(cv, q, target);
+
+            // Switch at once on the first block
+            if (!m_InputState.valid) {
+                for (size_t s=0; s<STAGES; ++s) {
+                    c[s] = target[s];
+                }
+            }
+
+            m_InputState.valid = true;
+            m_InputState.cv    = cv;
+            m_InputState.q     = q;
+        }
+        else {
+            for (size_t s=0; s<STAGES; ++s) {
+                target[s] = c[s];
+            }
+        }
+
+        const float k = 1.0f / (float)count;
+        for (size_t s=0; s<STAGES; ++s) {
+            dc[s].k  = (target[s].k  - c[s].k)  * k;
+            dc[s].a1 = (target[s].a1 - c[s].a1) * k;
+            dc[s].a2 = (target[s].a2 - c[s].a2) * k;
+            dc[s].a3 = (target[s].a3 - c[s].a3) * k;
+        }
+
+        // Filter
+        for (size_t j=i; j<=last; ++j) {
+
+            for (size_t s=0; s<STAGES; ++s) {
+                c[s].k  += dc[s].k;
+                c[s].a1 += dc[s].a1;
+                c[s].a2 += dc[s].a2;
+                c[s].a3 += dc[s].a3;
+            }
+
+            const float x = ptrIn[j];
+
+            // A single stage provides all the outputs at once
+            if (STAGES == 1) {
+                const SVF::Output y = SVF::tick(c[0], lp[0], x);
+
+                if (LP) ptrLp[j] = y.lp;
+                if (BP) ptrBp[j] = y.bp;
+                if (HP) ptrHp[j] = y.hp;
+                continue;
+            }
+
+            // Otherwise each output cascades stages of its own kind
+            if (LP) {
+                float y = x;
+                for (size_t s=0; s<STAGES; ++s) {
+                    y = SVF::tick(c[s], lp[s], y).lp;
+                }
+                ptrLp[j] = y;
+            }
+            if (BP) {
+                float y = x;
+                for (size_t s=0; s<STAGES; ++s) {
+                    y = SVF::tick(c[s], bp[s], y).bp;
+                }
+                ptrBp[j] = y;
+            }
+            if (HP) {
+                float y = x;
+                for (size_t s=0; s<STAGES; ++s) {
+                    y = SVF::tick(c[s], hp[s], y).hp;
+                }
+                ptrHp[j] = y;
+            }
+        }
+
+        // Land exactly on the target
+        for (size_t s=0; s<STAGES; ++s) {
+            c[s] = target[s];
+        }
+
+        i += count;
+    }
+
+    // Store
+    for (size_t s=0; s<STAGES; ++s) {
+        m_Coeffs   [s] = c [s];
+        m_States[0][s] = lp[s];
+        m_States[1][s] = bp[s];
+        m_States[2][s] = hp[s];
+    }
+}
+
+SVF::Kernel SVF::selectKernel (bool a_Lp, bool a_Bp, bool a_Hp) const {
+
+    #define SELECT_OUTPUTS(n) \
+        if ( a_Lp &&  a_Bp &&  a_Hp) return &SVF::processCascade<n, true,  true,  true >; \
+        if ( a_Lp &&  a_Bp && !a_Hp) return &SVF::processCascade<n, true,  true,  false>; \
+        if ( a_Lp && !a_Bp &&  a_Hp) return &SVF::processCascade<n, true,  false, true >; \
+        if ( a_Lp && !a_Bp && !a_Hp) return &SVF::processCascade<n, true,  false, false>; \
+        if (!a_Lp &&  a_Bp &&  a_Hp) return &SVF::processCascade<n, false, true,  true >; \
+        if (!a_Lp &&  a_Bp && !a_Hp) return &SVF::processCascade<n, false, true,  false>; \
+        if (!a_Lp && !a_Bp &&  a_Hp) return &SVF::processCascade<n, false, false, true >; \
+        return &SVF::processCascade<n, false, false, false>;
+
+    switch (m_Stages)
+    {
+    case 1:  SELECT_OUTPUTS(1);
+    case 2:  SELECT_OUTPUTS(2);
+    case 4:  SELECT_OUTPUTS(4);
+    default: THROW(BuildError, "Invalid stage count %zu", m_Stages);
+    }
+
+    #undef SELECT_OUTPUTS
+}
+
+// ============================================================================
+
+void SVF::process () {
+
+    // Process
+    (this->*m_Kernel)();
+
+    // All outputs are computed at once, clear dirty flags on all of them
+    m_Lp->clearDirty();
+    m_Bp->clearDirty();
+    m_Hp->clearDirty();
+}
+
+// ============================================================================
+
+}; // Modules
+}; // Graph
@@ -0,0 +1,97 @@
+#ifndef GRAPH_MODULES_SVF_HH
+#define GRAPH_MODULES_SVF_HH
+
+#include "../module.hh"
+#include "../processing/svf.hh"
+
+#include <string>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Graph {
+namespace Modules {
+
+// ============================================================================
+
+/// A state variable filter with simultaneous lowpass, bandpass and highpass
+/// outputs. Can cascade up to 4 stages (8 poles) processed in a single loop.
+class SVF : public Module {
+public:
+
+    /// Constructor
+    SVF (const std::string& a_Name,
+         const Module::Attributes& a_Attributes = Module::Attributes()
+    );
+
+    /// Creates an instance
+    static Module* create (
+        const std::string& a_Type,
+        const std::string& a_Name,
+        const Module::Attributes& a_Attributes = Module::Attributes()
+    );
+
+    /// Called on the graph initialization
+    void prepare (float a_SampleRate, size_t a_BufferSize) override;
+    /// Called on start
+    void start   () override;
+
+    /// Processes a single audio buffer
+    void process () override;
+
+protected:
+
+    /// Kernel type
+    typedef void (SVF::*Kernel) ();
+
+    /// Processes the cascade of the given number of stages computing only
+    /// the selected outputs
+    template <size_t STAGES, bool LP, bool BP, bool HP>
+    void processCascade ();
+
+    /// Selects a kernel for the stage count and connected outputs
+    Kernel selectKernel (bool a_Lp, bool a_Bp, bool a_Hp) const;
+
+    /// Computes coefficients of all stages for the given control state
+    void computeCoeffs (float a_Cv, float a_Q,
+                        Processing::SVF::Coeffs* a_Coeffs) const;
+
+    /// Number of 2-pole stages
+    size_t m_Stages;
+    /// Coefficient update interval [samples]
+    size_t m_ControlInterval;
+    /// Divides sample indices into indices of control inputs
+    size_t m_ControlDivider = 1;
+
+    /// Kernel
+    Kernel m_Kernel = nullptr;
+
+    /// Current coefficients of all stages
+    Processing::SVF::Coeffs m_Coeffs [Processing::SVF::MAX_STAGES];
+    /// States of all stages for lowpass, bandpass and highpass cascades
+    Processing::SVF::State  m_States [3][Processing::SVF::MAX_STAGES];
+
+    /// Last input state
+    struct {
+        bool    valid;
+        float   cv;
+        float   q;
+    } m_InputState;
+
+    /// Input ports
+    Port* m_Input;
+    Port* m_Freq;
+    Port* m_Q;
+
+    /// Output ports
+    Port* m_Lp;
+    Port* m_Bp;
+    Port* m_Hp;
+};
+
+// ============================================================================
+
+}; // Modules
+}; // Graph
+
+#endif // GRAPH_MODULES_SVF_HH
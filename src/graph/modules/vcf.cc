@@ -3,10 +3,13 @@
 #include "vcf.hh"
 
 #include <utils/utils.hh>
+#include <utils/math.hh>
 #include <utils/exception.hh>
 #include <stringf.hh>
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
 namespace Graph {
 namespace Modules {
@@ -17,11 +20,28 @@ VCF::VCF (const std::string& a_Name,
           const Module::Attributes& a_Attributes) :
     Module ("vcf", a_Name, a_Attributes)
 {
+    // Coefficient update interval. When greater than one the coefficients
+    // are computed once per interval and interpolated in between.
+    int interval = std::stoi(a_Attributes.get("controlInterval", "1"));
+    if (interval < 1) {
+        THROW(BuildError, "Invalid control interval %d", interval);
+    }
+
+    m_ControlInterval = interval;
+
+    // Control inputs are only sampled at interval ends. When these align
+    // with control rate sub-blocks take them at the control rate.
+    Port::Rate rate = Port::Rate::AUDIO;
+    if (m_ControlInterval % Port::CONTROL_PERIOD == 0) {
+        rate = Port::Rate::CONTROL;
+        m_ControlDivider = Port::CONTROL_PERIOD;
+    }
+
     // Input ports
     m_Input  = addPort(new Port(this, "in",   Port::Direction::INPUT, 0.0f));
-    m_Freq   = addPort(new Port(this, "freq", Port::Direction::INPUT, 0.0f));
-    m_Gain   = addPort(new Port(this, "gain", Port::Direction::INPUT, 0.0f));
-    m_Q      = addPort(new Port(this, "q",    Port::Direction::INPUT, 1.0f));
+    m_Freq   = addPort(new Port(this, "freq", Port::Direction::INPUT, 0.0f, rate));
+    m_Gain   = addPort(new Port(this, "gain", Port::Direction::INPUT, 0.0f, rate));
+    m_Q      = addPort(new Port(this, "q",    Port::Direction::INPUT, 1.0f, rate));
 
     // Output port
     m_Output = addPort(new Port(this, "out",  Port::Direction::OUTPUT));
@@ -40,6 +60,15 @@ VCF::VCF (const std::string& a_Name,
         "highShelf"
     }, "Filter type"));
 
+    // Coefficient table resolution. When non-zero the coefficients are
+    // looked up in a table shared by all VCFs instead of being computed.
+    int resolution = std::stoi(a_Attributes.get("lutResolution", "0"));
+    if (resolution < 0) {
+        THROW(BuildError, "Invalid LUT resolution %d", resolution);
+    }
+
+    m_LutResolution = resolution;
+
     // Apply overrides
     applyParameterOverrides(a_Attributes);
 }
@@ -55,8 +84,62 @@ Module* VCF::create (
 
 // ============================================================================
 
+Processing::BiquadIIR::ComputeFunction VCF::getFunction (int32_t a_Type) {
+
+    switch(a_Type)
+    {
+    case 0: return Processing::BiquadIIR::computeLPF;
+    case 1: return Processing::BiquadIIR::computeHPF;
+    case 2: return Processing::BiquadIIR::computeBPF;
+    case 3: return Processing::BiquadIIR::computeNotch;
+    case 4: return Processing::BiquadIIR::computeAPF;
+    case 5: return Processing::BiquadIIR::computePeak;
+    case 6: return Processing::BiquadIIR::computeLowShelf;
+    case 7: return Processing::BiquadIIR::computeHighShelf;
+    default: THROW(ProcessingError, "Invalid filter type %d!", a_Type);
+    }
+}
+
+void VCF::fetchLut () {
+
+    if (!m_LutResolution || m_SampleRate <= 0.0f) {
+        return;
+    }
+
+    int32_t type = m_Parameters.get("type").get().asNumber();
+    if (m_LutType == type) {
+        return;
+    }
+
+    // Tables are shared, this builds one on the first request only
+    bool usesGain = (type >= 5);
+    m_Lut = Processing::BiquadLUT::get(getFunction(type), usesGain,
+                                       m_SampleRate, m_LutResolution);
+    m_LutType = type;
+}
+
+// ============================================================================
+
+void VCF::prepare (float a_SampleRate, size_t a_BufferSize) {
+    Module::prepare(a_SampleRate, a_BufferSize);
+
+    // Drop a table of another sample rate
+    m_Lut.reset();
+    m_LutType = -1;
+
+    fetchLut();
+}
+
+void VCF::updateParameters (const ParameterValues& a_Values) {
+    Module::updateParameters(a_Values);
+    fetchLut();
+}
+
 void VCF::start () {
 
+    // Call the base method
+    Module::start();
+
     // Reset state
     m_InputState.type = -1;
     m_InputState.cv   = 0.0f;
@@ -76,24 +159,19 @@ void VCF::process () {
     }
 
     // Set coefficient computation function pointer
-    const Processing::BiquadIIR::Coeffs (*compute)(float, float, float, float) = nullptr;
+    Processing::BiquadIIR::ComputeFunction compute = nullptr;
     int32_t type = -1;
 
     if (!bypass) {
-        type = m_Parameters.get("type").get().asNumber();
-
-        switch(type)
-        {
-        case 0: compute = Processing::BiquadIIR::computeLPF;       break;
-        case 1: compute = Processing::BiquadIIR::computeHPF;       break;
-        case 2: compute = Processing::BiquadIIR::computeBPF;       break;
-        case 3: compute = Processing::BiquadIIR::computeNotch;     break;
-        case 4: compute = Processing::BiquadIIR::computeAPF;       break;
-        case 5: compute = Processing::BiquadIIR::computePeak;      break;
-        case 6: compute = Processing::BiquadIIR::computeLowShelf;  break;
-        case 7: compute = Processing::BiquadIIR::computeHighShelf; break;
-        default: THROW(ProcessingError, "Invalid filter type %d!", type);
-        }
+        type    = m_Parameters.get("type").get().asNumber();
+        compute = getFunction(type);
+    }
+
+    // Use the table only if it was fetched for this type. It is never
+    // fetched here as that may lock and build it.
+    const Processing::BiquadLUT* lut = nullptr;
+    if (m_LutType == type) {
+        lut = m_Lut.get();
     }
 
     // Get pointers
@@ -111,27 +189,54 @@ void VCF::process () {
     
     // Process
     else {
-        for (size_t i=0; i<m_BufferSize; ++i) {
+        size_t i = 0;
+        while (i < m_BufferSize) {
 
-            // Get control state
-            float cv   = *ptrFreq++;
-            float gain = *ptrGain++;
-            float q    = *ptrQ++;
+            // Process up to the next control point
+            size_t count = std::min(m_ControlInterval, m_BufferSize - i);
+            size_t last  = i + count - 1;
 
-            // Something changed, recompute
-            if (m_InputState.type != type ||
-                m_InputState.cv   != cv   ||
-                m_InputState.gain != gain ||
-                m_InputState.q    != q)
+            // Get control state at the end of the interval
+            size_t ctrl = last / m_ControlDivider;
+            float  cv   = ptrFreq[ctrl];
+            float  gain = ptrGain[ctrl];
+            float  q    = ptrQ[ctrl];
+
+            // Nothing changed, filter
+            if (m_InputState.type == type &&
+                m_InputState.cv   == cv   &&
+                m_InputState.gain == gain &&
+                m_InputState.q    == q)
             {
-                float f = Utils::cvToFrequency(cv);
+                m_Filter.process(ptrOut + i, ptrIn + i, count);
+            }
+
+            // Something changed, recompute
+            else {
 
                 // Limit
-                if (q <  0.1f) q =  0.1f; // FIXME: Arbitrary!
-                if (q > 20.0f) q = 20.0f;
+                float qc = q;
+                if (qc <  0.1f) qc =  0.1f; // FIXME: Arbitrary!
+                if (qc > 20.0f) qc = 20.0f;
+
+                // Compute or look up
+                Processing::BiquadIIR::Coeffs coeffs;
+                if (lut) {
+                    coeffs = lut->lookup(cv, gain, qc);
+                } else {
+                    float f = Utils::Math::fastCvToFrequency(cv);
+                    coeffs  = compute(f, gain, qc, m_SampleRate);
+                }
 
-                // Compute
-                m_Filter.setCoeffs(compute(f, gain, q, m_SampleRate));
+                // Ramp the coefficients over the interval. Switch at once
+                // when the filter type changed.
+                if (m_InputState.type == type) {
+                    m_Filter.process(ptrOut + i, ptrIn + i, count, coeffs);
+                }
+                else {
+                    m_Filter.setCoeffs(coeffs);
+                    m_Filter.process(ptrOut + i, ptrIn + i, count);
+                }
 
                 // Store state
                 m_InputState.type = type;
@@ -140,8 +245,7 @@ void VCF::process () {
                 m_InputState.q    = q;
             }
 
-            // Filter
-            *ptrOut++ = m_Filter.process(*ptrIn++);
+            i += count;
         }
     }
 }
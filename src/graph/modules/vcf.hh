@@ -3,8 +3,10 @@
 
 #include "../module.hh"
 #include "../processing/biquad_iir.hh"
+#include "../processing/biquad_lut.hh"
 
 #include <string>
+#include <memory>
 
 #include <cstddef>
 #include <cstdint>
@@ -30,16 +32,39 @@ public:
         const Module::Attributes& a_Attributes = Module::Attributes()
     );
 
+    /// Called on the graph initialization
+    void prepare (float a_SampleRate, size_t a_BufferSize) override;
     /// Called on start
     void start () override;
 
+    /// Updates module parameters. Fetches the coefficient table when the
+    /// filter type changes.
+    void updateParameters (const ParameterValues& a_Values) override;
+
     /// Processes a single audio buffer
     void process () override;
 
 protected:
 
+    /// Returns the coefficient computation function of a filter type
+    static Processing::BiquadIIR::ComputeFunction getFunction (int32_t a_Type);
+    /// Fetches the coefficient table of the current filter type if not held
+    /// already. May build it, never called from process().
+    void fetchLut ();
+
     /// The filter
     Processing::BiquadIIR m_Filter;
+    /// Coefficient update interval [samples]
+    size_t m_ControlInterval;
+    /// Divides sample indices into indices of control inputs
+    size_t m_ControlDivider = 1;
+
+    /// Coefficient table resolution, 0 when not used
+    size_t  m_LutResolution;
+    /// Coefficient table for the current filter type
+    std::shared_ptr<const Processing::BiquadLUT> m_Lut;
+    /// Filter type of the current table
+    int32_t m_LutType = -1;
 
     /// Last input state
     struct {
@@ -64,5 +89,5 @@ protected:
 }; // Modules
 }; // Graph
 
-#endif // GRAPH_MODULES_VGA_HH
+#endif // GRAPH_MODULES_VCF_HH
 
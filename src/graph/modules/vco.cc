@@ -10,6 +10,7 @@
 #include <utils/math.hh>
 #include <stringf.hh>
 
+#include <algorithm>
 #include <cmath>
 
 namespace Graph {
@@ -17,18 +18,71 @@ namespace Modules {
 
 // ============================================================================
 
+namespace {
+
+/// Marks the phase wrap as rarely taken. GCC otherwise turns it into a
+/// compare and blend, which lengthens the loop-carried phase dependency.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 9
+#define VCO_RARELY(x) __builtin_expect_with_probability((x), 0, 0.01)
+#else
+#define VCO_RARELY(x) __builtin_expect((x), 0)
+#endif
+
+/// Highest phase increment per sample without FM, the Nyquist frequency.
+/// Frequencies above the sample rate, or above a fraction of it at the
+/// control rate, are clamped to it so that the phase wraps by one at most.
+constexpr float MAX_INC = 0.5f;
+
+/// Limits the phase increment when the phase is wrapped by one cycle. FM
+/// increments are left as they are since their wrap uses floor.
+template <bool FM>
+inline float limitInc (float a_Inc) {
+    return FM ? a_Inc : std::min(a_Inc, MAX_INC);
+}
+
+/// Wraps the accumulated phase back to the [0, 1] range. Without FM the
+/// phase only grows, by at most MAX_INC per sample, so a single conditional
+/// subtraction does. FM can move it by any amount in either direction.
+template <bool FM>
+inline float wrapPhase (float a_Phi) {
+    if (FM) {
+        return a_Phi - floorf(a_Phi);
+    }
+
+    if (VCO_RARELY(a_Phi > 1.0f)) {
+        a_Phi -= 1.0f;
+    }
+
+    return a_Phi;
+}
+
+}; // Anonymous
+
+// ============================================================================
+
 VCO::VCO (const std::string& a_Name,
           const Module::Attributes& a_Attributes) :
     Module ("vco", a_Name, a_Attributes)
 {
+    // Rate of all ports. The control rate suits LFOs.
+    Port::Rate rate = Port::Rate::AUDIO;
+
+    auto rateName = a_Attributes.get("rate", "audio");
+    if (rateName == "control") {
+        rate = Port::Rate::CONTROL;
+    }
+    else if (rateName != "audio") {
+        THROW(BuildError, "Invalid VCO rate '%s'", rateName.c_str());
+    }
+
     // Input ports
-    m_CvIn   = addPort(new Port(this, "cv" , Port::Direction::INPUT, 0.0f));
-    m_AmIn   = addPort(new Port(this, "am" , Port::Direction::INPUT, 0.0f));
-    m_FmIn   = addPort(new Port(this, "fm" , Port::Direction::INPUT, 0.0f));
-    m_PwmIn  = addPort(new Port(this, "pwm", Port::Direction::INPUT, 0.5f));
+    m_CvIn   = addPort(new Port(this, "cv" , Port::Direction::INPUT, 0.0f, rate));
+    m_AmIn   = addPort(new Port(this, "am" , Port::Direction::INPUT, 0.0f, rate));
+    m_FmIn   = addPort(new Port(this, "fm" , Port::Direction::INPUT, 0.0f, rate));
+    m_PwmIn  = addPort(new Port(this, "pwm", Port::Direction::INPUT, 0.5f, rate));
 
     // Output ports
-    m_Output = addPort(new Port(this, "out", Port::Direction::OUTPUT));
+    m_Output = addPort(new Port(this, "out", Port::Direction::OUTPUT, rate));
 
     // Define parameters
     m_Parameters.set("waveform",  Parameter("sine", {
@@ -42,6 +96,9 @@ VCO::VCO (const std::string& a_Name,
         "derived_square",
         "triangle",
         "sawtooth",
+        "polyblep_square",
+        "polyblep_sawtooth",
+        "polyblamp_triangle",
     }, "Waveform"));
 
     const float semitone = 1.0 / 12.0;
@@ -79,100 +136,338 @@ void VCO::prepare (float a_SampleRate, size_t a_BufferSize) {
     if (!m_FmIn->isConnected()) {
         m_Parameters.get("fmGain").setLock(true);
     }
+
+    // Get wavetables for all waveforms so that switching between them never
+    // builds a table during processing. The tables are shared between all
+    // VCOs. Waveforms that depend on the PWM input are tabulated for the
+    // default PWM value. Anti-aliased block functions need no table.
+    size_t count = m_Parameters.get("waveform").getChoices().size();
+
+    m_Wavetables.clear();
+    for (size_t i=0; i<count; ++i) {
+        if (getBlockFunction(i) != nullptr) {
+            m_Wavetables.push_back(nullptr);
+        } else {
+            m_Wavetables.push_back(
+                Processing::Wavetable::get(getWaveFunction(i), 0.5f)
+            );
+        }
+    }
+
+    // Count of output values per buffer
+    m_Size = m_Output->getBufferSize(a_BufferSize);
+
+    // Phase buffer
+    m_Phases.create(m_Size);
+
+    // Select kernels according to connected inputs
+    bool am  = m_AmIn->isConnected();
+    bool fm  = m_FmIn->isConnected();
+    bool pwm = m_PwmIn->isConnected();
+
+    m_Kernels.clear();
+    for (size_t i=0; i<count; ++i) {
+        m_Kernels.push_back(selectKernel(m_Size, i, am, fm, pwm));
+    }
 }
 
 void VCO::start () {
+
+    // Call the base method
+    Module::start();
+
     m_Phase = 0.0f;
 }
 
 // ============================================================================
 
-void VCO::process () {
+VCO::WaveFunction VCO::getWaveFunction (int32_t a_Wave) {
 
-    // Scaling factor - HZ to cycles
-    const float k = 1.0f / m_SampleRate;
+    switch (a_Wave)
+    {
+    case 0:  return Processing::Waveform::sine;
+    case 1:  return Processing::Waveform::half_sine;
+    case 2:  return Processing::Waveform::abs_sine;
+    case 3:  return Processing::Waveform::pulse_sine;
+    case 4:  return Processing::Waveform::even_sine;
+    case 5:  return Processing::Waveform::even_abs_sine;
+    case 6:  return Processing::Waveform::square;
+    case 7:  return Processing::Waveform::derived_square;
+    case 8:  return Processing::Waveform::triangle;
+    case 9:  return Processing::Waveform::sawtooth;
+    case 10: return Processing::Waveform::square;
+    case 11: return Processing::Waveform::sawtooth;
+    case 12: return Processing::Waveform::triangle;
+    default: THROW(ProcessingError, "Invalid waveform id %d", a_Wave);
+    }
+}
 
-    // Waveform
-    float (*waveFunc)(float, float) = nullptr;
-    int32_t wave = m_Parameters.get("waveform").get().asNumber();
+bool VCO::isPwmDependent (int32_t a_Wave) {
+    return a_Wave == 6 || a_Wave == 7 || a_Wave == 8;
+}
 
-    switch (wave)
+VCO::BlockFunction VCO::getBlockFunction (int32_t a_Wave) {
+
+    switch (a_Wave)
     {
-    case 0:  waveFunc = Processing::Waveform::sine;          break;
-    case 1:  waveFunc = Processing::Waveform::half_sine;     break;
-    case 2:  waveFunc = Processing::Waveform::abs_sine;      break;
-    case 3:  waveFunc = Processing::Waveform::pulse_sine;    break;
-    case 4:  waveFunc = Processing::Waveform::even_sine;     break;
-    case 5:  waveFunc = Processing::Waveform::even_abs_sine; break;
-    case 6:  waveFunc = Processing::Waveform::square;        break;
-    case 7:  waveFunc = Processing::Waveform::derived_square;break;
-    case 8:  waveFunc = Processing::Waveform::triangle;      break;
-    case 9:  waveFunc = Processing::Waveform::sawtooth;      break;
-    default: THROW(ProcessingError, "Invalid waveform id %d", wave);
+    case 10: return Processing::Waveform::polyblep_square;
+    case 11: return Processing::Waveform::polyblep_sawtooth;
+    case 12: return Processing::Waveform::polyblamp_triangle;
+    default: return nullptr;
     }
+}
 
-    // Amplitude
-    float A = m_Parameters.get("amplitude").get().asNumber();
-    A = Utils::Math::log2lin(A);
+// ============================================================================
 
-    // Phase
-    float phaseOffset = m_Parameters.get("phase").get().asNumber();
-    phaseOffset /= 360.0f;
+template <size_t N, bool AM, bool FM>
+float VCO::tableKernel (const Block& a_Block, float a_Phi) {
 
-    // Detune amount
-    float detune = m_Parameters.get("detune").get().asNumber();
+    const size_t size = N ? N : a_Block.size;
+    float* ptrPhase   = a_Block.phase;
+    float* ptrOut     = a_Block.out;
+    float  phi        = a_Phi;
+    float  maxInc     = 0.0f;
 
-    // Amplitude modulation index
-    float alpha = m_Parameters.get("amGain").get().asNumber();
-    // Frequency modulation index
-    float beta  = m_Parameters.get("fmGain").get().asNumber();
+    // Accumulate phase
+    for (size_t i=0; i<size; ++i) {
 
-    // Get pointers
-    float* ptrOut         = m_Output->getBuffer().data();
-    const float* ptrCvIn  = m_CvIn->process().data();
-    const float* ptrAmIn  = m_AmIn->process().data();
-    const float* ptrFmIn  = m_FmIn->process().data();
-    const float* ptrPwmIn = m_PwmIn->process().data();
+        float f = ptrOut[i];
+        if (FM) {
+            f *= (1.0f + a_Block.beta * a_Block.fm[i]);
+        }
 
-    // Add phase offset
-    float phi = m_Phase + phaseOffset;
-    while (phi > 1.0f) phi -= 1.0f;
-    while (phi < 0.0f) phi += 1.0f;
+        float inc = limitInc<FM>(f * a_Block.k);
+        maxInc = std::max(maxInc, FM ? fabsf(inc) : inc);
+
+        ptrPhase[i] = phi;
+        phi = wrapPhase<FM>(phi + inc);
+    }
 
-    // Generate the wave
-    for (size_t i=0; i<m_BufferSize; ++i) {
+    // Render using the table level that is alias-free for the highest
+    // frequency in the block
+    auto   table = a_Block.table;
+    size_t level = table->getLevel(maxInc);
 
-        // Add AM modulation
-        float am = *ptrAmIn++;
-        float a  = A * (1.0f + alpha * am);        
+    if (AM) {
+        for (size_t i=0; i<size; ++i) {
+            ptrOut[i] = a_Block.A * (1.0f + a_Block.alpha * a_Block.am[i]);
+        }
+
+        table->render(level, ptrPhase, ptrOut, ptrOut, size);
+    }
+    else {
+        table->render(level, ptrPhase, a_Block.A, ptrOut, size);
+    }
+
+    return phi;
+}
+
+template <size_t N, bool AM, bool FM, bool PWM, VCO::WaveFunction F>
+float VCO::functionKernel (const Block& a_Block, float a_Phi) {
 
-        // Convert CV to frequency
-        float cv = *ptrCvIn++;
-        float f  = Utils::cvToFrequency(cv + detune);
+    const size_t size = N ? N : a_Block.size;
+    float* ptrOut     = a_Block.out;
+    float  phi        = a_Phi;
+
+    for (size_t i=0; i<size; ++i) {
+
+        // Add AM modulation
+        float a = a_Block.A;
+        if (AM) {
+            a *= (1.0f + a_Block.alpha * a_Block.am[i]);
+        }
 
         // Add FM modulation
-        float fm = *ptrFmIn++;
-        f *= (1.0f + beta * fm);
+        float f = ptrOut[i];
+        if (FM) {
+            f *= (1.0f + a_Block.beta * a_Block.fm[i]);
+        }
 
         // Generate the waveform
-        float pwm = *ptrPwmIn++;
-        *ptrOut++ = a * waveFunc(phi, pwm);
+        float pwm = PWM ? a_Block.pwm[i] : 0.5f;
+        ptrOut[i] = a * F(phi, pwm);
 
         // Accumulate phase
-        phi += f * k;
-        while (phi > 1.0f) phi -= 1.0f;
+        phi = wrapPhase<FM>(phi + limitInc<FM>(f * a_Block.k));
+    }
+
+    return phi;
+}
+
+template <size_t N, bool AM, bool FM, VCO::BlockFunction F>
+float VCO::blockKernel (const Block& a_Block, float a_Phi) {
+
+    const size_t size = N ? N : a_Block.size;
+    float* ptrPhase   = a_Block.phase;
+    float* ptrOut     = a_Block.out;
+    float  phi        = a_Phi;
+
+    // Accumulate phase, replace frequencies with phase increments
+    for (size_t i=0; i<size; ++i) {
+
+        float f = ptrOut[i];
+        if (FM) {
+            f *= (1.0f + a_Block.beta * a_Block.fm[i]);
+        }
+
+        float inc = limitInc<FM>(f * a_Block.k);
+
+        ptrPhase[i] = phi;
+        ptrOut[i]   = inc;
+
+        phi = wrapPhase<FM>(phi + inc);
+    }
+
+    // Render. The PWM input holds its default value when not connected.
+    F(ptrOut, ptrPhase, ptrOut, a_Block.pwm, size);
+
+    // Apply amplitude
+    if (AM) {
+        for (size_t i=0; i<size; ++i) {
+            ptrOut[i] *= a_Block.A * (1.0f + a_Block.alpha * a_Block.am[i]);
+        }
+    }
+    else {
+        Audio::Kernels::Fixed<N>::scale(ptrOut, a_Block.A, size);
+    }
+
+    return phi;
+}
+
+template <size_t N>
+VCO::Kernel VCO::selectKernel (int32_t a_Wave, bool a_Am, bool a_Fm,
+                               bool a_Pwm)
+{
+    using namespace Processing::Waveform;
+
+    // Anti-aliased block functions handle PWM on their own
+    #define BLOCK_KERNEL(f) \
+        if ( a_Am &&  a_Fm) return &blockKernel<N, true,  true,  f>; \
+        if ( a_Am && !a_Fm) return &blockKernel<N, true,  false, f>; \
+        if (!a_Am &&  a_Fm) return &blockKernel<N, false, true,  f>; \
+        return &blockKernel<N, false, false, f>;
+
+    switch (a_Wave)
+    {
+    case 10: BLOCK_KERNEL(polyblep_square);
+    case 11: BLOCK_KERNEL(polyblep_sawtooth);
+    case 12: BLOCK_KERNEL(polyblamp_triangle);
+    default: break;
+    }
+
+    #undef BLOCK_KERNEL
+
+    // The waveform shape is modulated, the function has to be evaluated for
+    // each sample.
+    if (a_Pwm && isPwmDependent(a_Wave)) {
+
+        #define FUNCTION_KERNEL(f) \
+            if ( a_Am &&  a_Fm) return &functionKernel<N, true,  true,  true, f>; \
+            if ( a_Am && !a_Fm) return &functionKernel<N, true,  false, true, f>; \
+            if (!a_Am &&  a_Fm) return &functionKernel<N, false, true,  true, f>; \
+            return &functionKernel<N, false, false, true, f>;
+
+        switch (a_Wave)
+        {
+        case 6:  FUNCTION_KERNEL(square);
+        case 7:  FUNCTION_KERNEL(derived_square);
+        case 8:  FUNCTION_KERNEL(triangle);
+        default: THROW(ProcessingError, "Invalid waveform id %d", a_Wave);
+        }
+
+        #undef FUNCTION_KERNEL
+    }
+
+    // Use the wavetable
+    if ( a_Am &&  a_Fm) return &tableKernel<N, true,  true>;
+    if ( a_Am && !a_Fm) return &tableKernel<N, true,  false>;
+    if (!a_Am &&  a_Fm) return &tableKernel<N, false, true>;
+    return &tableKernel<N, false, false>;
+}
+
+VCO::Kernel VCO::selectKernel (size_t a_BufferSize, int32_t a_Wave,
+                               bool a_Am, bool a_Fm, bool a_Pwm)
+{
+    switch (getFixedKernelSize(a_BufferSize))
+    {
+    case 32:  return selectKernel<32> (a_Wave, a_Am, a_Fm, a_Pwm);
+    case 64:  return selectKernel<64> (a_Wave, a_Am, a_Fm, a_Pwm);
+    case 128: return selectKernel<128>(a_Wave, a_Am, a_Fm, a_Pwm);
+    case 256: return selectKernel<256>(a_Wave, a_Am, a_Fm, a_Pwm);
+    default:  return selectKernel<0>  (a_Wave, a_Am, a_Fm, a_Pwm);
+    }
+}
+
+// ============================================================================
+
+void VCO::process () {
+
+    // Waveform
+    int32_t wave = m_Parameters.get("waveform").get().asNumber();
+    if (wave < 0 || wave >= (int32_t)m_Kernels.size()) {
+        THROW(ProcessingError, "Invalid waveform id %d", wave);
+    }
+
+    // Amplitude
+    float A = m_Parameters.get("amplitude").get().asNumber();
+    A = Utils::Math::log2lin(A);
+
+    // Phase
+    float phaseOffset = m_Parameters.get("phase").get().asNumber();
+    phaseOffset /= 360.0f;
+
+    // Detune amount
+    float detune = m_Parameters.get("detune").get().asNumber();
+
+    // At the control rate the phase advances by a whole sub-block per value
+    float period = 1.0f;
+    if (m_Output->getRate() == Port::Rate::CONTROL) {
+        period = (float)Port::CONTROL_PERIOD;
     }
 
+    // Setup the block
+    Block block;
+    block.size  = m_Size;
+    block.k     = period / m_SampleRate;
+    block.A     = A;
+    block.alpha = m_Parameters.get("amGain").get().asNumber();
+    block.beta  = m_Parameters.get("fmGain").get().asNumber();
+    block.am    = m_AmIn->process().data();
+    block.fm    = m_FmIn->process().data();
+    block.pwm   = m_PwmIn->process().data();
+    block.out   = m_Output->getBuffer().data();
+    block.phase = m_Phases.data();
+    block.table = m_Wavetables[wave].get();
+
+    // Convert CV to frequency for the whole block. Use the output buffer as
+    // temporary storage.
+    const float* ptrCvIn = m_CvIn->process().data();
+    Utils::Math::cvToFrequency(block.out, ptrCvIn, m_Size, detune);
+
+    // Add phase offset. The offset is within half a cycle so the phase
+    // needs to be wrapped by one at most.
+    float phi = m_Phase + phaseOffset;
+    if      (phi > 1.0f) phi -= 1.0f;
+    else if (phi < 0.0f) phi += 1.0f;
+
+    // Render
+    phi = m_Kernels[wave](block, phi);
+
     // Subtract phase offset
     phi -= phaseOffset;
-    while (phi > 1.0f) phi -= 1.0f;
-    while (phi < 0.0f) phi += 1.0f;
+    if      (phi > 1.0f) phi -= 1.0f;
+    else if (phi < 0.0f) phi += 1.0f;
 
     m_Phase = phi;
 }
 
 // ============================================================================
 
+size_t VCO::getMemoryUsage () const {
+    return Module::getMemoryUsage() + m_Phases.getSize() * sizeof(float);
+}
+
+// ============================================================================
+
 }; // Modules
 }; // Graph
-
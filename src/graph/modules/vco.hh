@@ -2,8 +2,14 @@
 #define GRAPH_MODULES_VCO_HH
 
 #include "../module.hh"
+#include "../processing/waveform.hh"
+#include "../processing/wavetable.hh"
+
+#include <audio/buffer.hh>
 
 #include <string>
+#include <vector>
+#include <memory>
 
 #include <cstddef>
 #include <cstdint>
@@ -37,11 +43,80 @@ public:
     /// Processes a single audio buffer
     virtual void process () override;
 
+    /// Returns an estimate of the memory used by buffers. Tables shared by
+    /// all instances are not included.
+    size_t getMemoryUsage () const override;
+
 protected:
 
+    /// Waveform function type
+    typedef Processing::Wavetable::Function WaveFunction;
+
+    /// Returns the waveform function for the given waveform choice index
+    static WaveFunction getWaveFunction (int32_t a_Wave);
+    /// Returns true when the waveform shape depends on the PWM input
+    static bool isPwmDependent (int32_t a_Wave);
+
+    /// Block waveform function type
+    typedef Processing::Waveform::BlockFunction BlockFunction;
+
+    /// Returns the anti-aliased block function for the given waveform choice
+    /// index or nullptr if the waveform is not rendered by one.
+    static BlockFunction getBlockFunction (int32_t a_Wave);
+
+    /// Processing state of a single block passed to kernels
+    struct Block {
+        size_t       size;      /// Sample count
+        float        k;         /// Hz to cycles per sample
+        float        A;         /// Amplitude
+        float        alpha;     /// AM modulation index
+        float        beta;      /// FM modulation index
+        const float* am;        /// AM input
+        const float* fm;        /// FM input
+        const float* pwm;       /// PWM input
+        float*       out;       /// Output. Holds frequencies [Hz] on entry
+        float*       phase;     /// Phase scratch buffer
+        const Processing::Wavetable* table; /// Wavetable (if used)
+    };
+
+    /// Kernel type. Renders a block starting at the given phase, returns
+    /// the phase at the end of the block.
+    typedef float (*Kernel) (const Block& a_Block, float a_Phi);
+
+    /// Wavetable kernel. Kernels process blocks of N samples, of
+    /// a_Block.size ones when N is 0.
+    template <size_t N, bool AM, bool FM>
+    static float tableKernel (const Block& a_Block, float a_Phi);
+    /// Waveform function kernel
+    template <size_t N, bool AM, bool FM, bool PWM, WaveFunction F>
+    static float functionKernel (const Block& a_Block, float a_Phi);
+    /// Anti-aliased block function kernel
+    template <size_t N, bool AM, bool FM, BlockFunction F>
+    static float blockKernel (const Block& a_Block, float a_Phi);
+
+    /// Selects a kernel for the given waveform and connected inputs
+    template <size_t N>
+    static Kernel selectKernel (int32_t a_Wave, bool a_Am, bool a_Fm,
+                                bool a_Pwm);
+    /// Selects a kernel for the given buffer size, waveform and connected
+    /// inputs
+    static Kernel selectKernel (size_t a_BufferSize, int32_t a_Wave,
+                                bool a_Am, bool a_Fm, bool a_Pwm);
+
+    /// Count of output values per buffer, fewer than samples at the control
+    /// rate
+    size_t m_Size = 0;
     /// Current phase accumulator
     float m_Phase = 0.0f;
 
+    /// Kernels for all waveforms, selected according to connected inputs
+    std::vector<Kernel> m_Kernels;
+
+    /// Band-limited wavetables for all waveforms
+    std::vector<std::shared_ptr<const Processing::Wavetable>> m_Wavetables;
+    /// Per-sample phase buffer for wavetable lookup
+    Audio::Buffer<float> m_Phases;
+
     /// Frequency (CV) input
     Port*  m_CvIn;
     /// AM input
@@ -1,7 +1,12 @@
+#include "../exception.hh"
+
 #include "vga.hh"
 #include <utils/math.hh>
 #include <utils/utils.hh>
+#include <utils/exception.hh>
+#include <stringf.hh>
 
+#include <algorithm>
 #include <cmath>
 
 namespace Graph {
@@ -22,9 +27,19 @@ VGA::VGA (const std::string& a_Name,
     // Output port
     m_Output = addPort(new Port(this, "out",  Port::Direction::OUTPUT));
 
-    // Cutoff gain
+    // Gain scale
+    auto scale = a_Attributes.get("scale", "db");
+    if (scale == "linear") {
+        m_Linear = true;
+    }
+    else if (scale != "db") {
+        THROW(BuildError, "Invalid gain scale '%s'", scale.c_str());
+    }
+
+    // Cutoff gain. Use the same approximation as in process() so that gains
+    // equal to the cutoff level compare exactly.
     float cutoffLevel = Utils::stof(a_Attributes.get("cutoff", "-96.0"));
-    m_Cutoff = Math::log2lin(cutoffLevel);
+    m_Cutoff = Math::fastLog2lin(cutoffLevel);
 }
 
 Module* VGA::create (
@@ -38,18 +53,111 @@ Module* VGA::create (
 
 // ============================================================================
 
-void VGA::process () {
+IBaseInterface* VGA::queryInterface (iid_t a_Id) {
+
+    // We have IHoldReporter
+    if (a_Id == IHoldReporter::ID) {
+        return static_cast<IHoldReporter*>(this);
+    }
+
+    return Module::queryInterface(a_Id);
+}
+
+// ============================================================================
+
+void VGA::prepare (float a_SampleRate, size_t a_BufferSize) {
 
-    // Process
+    // Call the base method
+    Module::prepare(a_SampleRate, a_BufferSize);
+
+    // Select the kernel
+    m_Kernel = selectKernel(a_BufferSize);
+}
+
+// ============================================================================
+
+template <size_t N, bool LINEAR>
+void VGA::processBuffer () {
+
+    const size_t size = N ? N : m_BufferSize;
+
+    // Get pointers
     const float* ptrIn   = m_Input->process().data();
     const float* ptrGain = m_Gain->process().data();
     float*       ptrOut  = m_Output->getBuffer().data();
 
-    for (size_t i=0; i<m_BufferSize; ++i) {
-        float k = Math::log2lin(*ptrGain++);
+    // Process. A linear gain needs no conversion.
+    for (size_t i=0; i<size; ++i) {
+        float k = LINEAR ? ptrGain[i] : Math::fastLog2lin(ptrGain[i]);
         if (k <= m_Cutoff) k = 0.0f;
-        *ptrOut++ = *ptrIn++ * k;
+        ptrOut[i] = ptrIn[i] * k;
+    }
+}
+
+VGA::Kernel VGA::selectKernel (size_t a_BufferSize) const {
+
+    #define SELECT_SCALE(n) \
+        return m_Linear ? &VGA::processBuffer<n, true> : \
+                          &VGA::processBuffer<n, false>;
+
+    switch (getFixedKernelSize(a_BufferSize))
+    {
+    case 32:  SELECT_SCALE(32);
+    case 64:  SELECT_SCALE(64);
+    case 128: SELECT_SCALE(128);
+    case 256: SELECT_SCALE(256);
+    default:  SELECT_SCALE(0);
     }
+
+    #undef SELECT_SCALE
+}
+
+// ============================================================================
+
+void VGA::process () {
+    (this->*m_Kernel)();
+}
+
+// ============================================================================
+
+size_t VGA::getHoldStart (const Port* a_Output, float* a_Value) {
+
+    if (a_Output != m_Output) {
+        return NONE;
+    }
+
+    // A gain below the cutoff mutes the output whatever the input does
+    float  gain;
+    size_t gainStart = IHoldReporter::queryHold(m_Gain, &gain);
+
+    float k = 0.0f;
+    if (gainStart != NONE) {
+        k = m_Linear ? gain : Math::fastLog2lin(gain);
+        if (k <= m_Cutoff) {
+            *a_Value = 0.0f;
+            return gainStart;
+        }
+    }
+
+    // Silent input
+    float  input;
+    size_t inputStart = IHoldReporter::queryHold(m_Input, &input);
+    if (inputStart == NONE) {
+        return NONE;
+    }
+
+    if (input == 0.0f) {
+        *a_Value = 0.0f;
+        return inputStart;
+    }
+
+    // Both hold
+    if (gainStart != NONE) {
+        *a_Value = input * k;
+        return std::max(gainStart, inputStart);
+    }
+
+    return NONE;
 }
 
 // ============================================================================
@@ -2,6 +2,7 @@
 #define GRAPH_MODULES_VGA_HH
 
 #include "../module.hh"
+#include "../iface/hold_reporter.hh"
 
 #include <string>
 
@@ -13,7 +14,7 @@ namespace Modules {
 
 // ============================================================================
 
-class VGA : public Module {
+class VGA : public Module, public IHoldReporter {
 public:
 
     /// Constructor
@@ -28,11 +29,36 @@ public:
         const Module::Attributes& a_Attributes = Module::Attributes()
     );
 
+    /// Query for a given interface id.
+    IBaseInterface* queryInterface (iid_t a_Id) override;
+
+    /// Called on the graph initialization
+    void prepare (float a_SampleRate, size_t a_BufferSize) override;
+
     /// Processes a single audio buffer
     void process () override;
 
+    /// The output holds zero once the gain holds below the cutoff or the
+    /// input holds zero, and any other value once both inputs hold.
+    size_t getHoldStart (const Port* a_Output, float* a_Value) override;
+
 protected:
 
+    /// Kernel type
+    typedef void (VGA::*Kernel) ();
+
+    /// Processes a buffer of N samples, of m_BufferSize ones when N is 0
+    template <size_t N, bool LINEAR>
+    void processBuffer ();
+
+    /// Selects a kernel for the buffer size and gain scale
+    Kernel selectKernel (size_t a_BufferSize) const;
+
+    /// Kernel
+    Kernel m_Kernel = nullptr;
+
+    /// Gain input is linear instead of dB
+    bool  m_Linear = false;
     /// Cutoff level (linear)
     float m_Cutoff;
 
@@ -15,21 +15,29 @@ namespace Graph {
 
 // ============================================================================
 
-Port::Port (Module* a_Module, const std::string& a_Name, Direction a_Direction) :
+constexpr size_t Port::CONTROL_PERIOD;
+
+// ============================================================================
+
+Port::Port (Module* a_Module, const std::string& a_Name, Direction a_Direction,
+            Rate a_Rate) :
     m_Module    (a_Module),
     m_Name      (a_Name),
     m_Direction (a_Direction),
     m_Type      (Type::BUFFERED),
+    m_Rate      (a_Rate),
     m_Default   (0.0f)
 {
     assert(a_Module != nullptr);
 }
 
-Port::Port (Module* a_Module, const std::string& a_Name, Direction a_Direction, float a_Default) :
+Port::Port (Module* a_Module, const std::string& a_Name, Direction a_Direction,
+            float a_Default, Rate a_Rate) :
     m_Module    (a_Module),
     m_Name      (a_Name),
     m_Direction (a_Direction),
     m_Type      (Type::PROXY),
+    m_Rate      (a_Rate),
     m_Default   (a_Default)
 {
     assert(a_Module != nullptr);
@@ -57,12 +65,29 @@ Port::Type Port::getType () const {
     return m_Type;
 }
 
+Port::Rate Port::getRate () const {
+    return m_Rate;
+}
+
+size_t Port::getBufferSize (size_t a_AudioSize) const {
+
+    if (m_Rate == Rate::CONTROL) {
+        return (a_AudioSize + CONTROL_PERIOD - 1) / CONTROL_PERIOD;
+    }
+
+    return a_AudioSize;
+}
+
 // ============================================================================
 
 bool Port::isConnected () {
     return (m_SourcePort != nullptr) || (!m_SinkPorts.empty());
 }
 
+Port* Port::getSource () const {
+    return m_SourcePort;
+}
+
 bool Port::isDirty () {
 
     // Buffered port
@@ -87,13 +112,22 @@ bool Port::isDirty () {
 
 void Port::setDirty (bool a_Propagate) {
 
-    // Already set
-    if (isDirty()) {
-        return;
+    // Proxy port, invalidate the converted signal and propagate the call
+    if (m_Type == Type::PROXY) {
+        m_IsDirty = true;
+
+        if (m_SourcePort != nullptr) {
+            m_SourcePort->setDirty(a_Propagate);
+        }
     }
 
     // Buffered port
-    if (m_Type == Type::BUFFERED) {
+    else if (m_Type == Type::BUFFERED) {
+
+        // Already set
+        if (m_IsDirty) {
+            return;
+        }
 
         // Set the local flag
         m_IsDirty = true;
@@ -108,14 +142,6 @@ void Port::setDirty (bool a_Propagate) {
             }
         }
     }
-
-    // Proxy port, propagate the call
-    else if (m_Type == Type::PROXY) {
-
-        if (m_SourcePort != nullptr) {
-            m_SourcePort->setDirty(a_Propagate);
-        }
-    }
 }
 
 void Port::clearDirty () {
@@ -190,10 +216,15 @@ void Port::updateSourcesAndSinks () {
 
         // Explore them
         for (auto& next : ports) {
-            assert(next->getType() == Type::PROXY);
 
+            // Got a buffered port. It is a boundary of a module that holds
+            // its own copy of the signal (eg. an oversampler), which then
+            // feeds further ports itself. Store it and stop there.
+            if (next->getType() == Type::BUFFERED) {
+                m_SinkPorts.push_back(next);
+            }
             // Got an input of a leaf module, store it.
-            if (next->getModule()->isLeaf()) {
+            else if (next->getModule()->isLeaf()) {
                 m_SinkPorts.push_back(next);
             }
             // A non-leaf module, explore further
@@ -216,6 +247,63 @@ void Port::setBuffer (const Audio::Buffer<float>& a_Buffer) {
     if (m_Type == Type::PROXY) {
         m_Buffer.fill(m_Default);
     }
+
+    m_IsDirty      = true;
+    m_HasLastValue = false;
+}
+
+void Port::reset () {
+
+    // Ramp from the first control value again instead of the last one of
+    // the previous run
+    m_HasLastValue = false;
+}
+
+void Port::convert (const Audio::Buffer<float>& a_Source) {
+
+    const float* src = a_Source.data();
+    float*       dst = m_Buffer.data();
+
+    // Control to audio, ramp linearly from the previous control value so
+    // that each one is reached at the last sample of its sub-block.
+    if (m_Rate == Rate::AUDIO) {
+        const size_t size = m_Buffer.getSize();
+
+        if (!m_HasLastValue) {
+            m_LastValue    = src[0];
+            m_HasLastValue = true;
+        }
+
+        float value = m_LastValue;
+        for (size_t i=0, j=0; i<size; i+=CONTROL_PERIOD, ++j) {
+            const size_t count = std::min(CONTROL_PERIOD, size - i);
+
+            // Unchanged, hold
+            if (src[j] == value) {
+                std::fill(dst + i, dst + i + count, value);
+                continue;
+            }
+
+            const float delta = (src[j] - value) / (float)count;
+            for (size_t k=0; k<count; ++k) {
+                value += delta;
+                dst[i + k] = value;
+            }
+
+            value = src[j];
+        }
+
+        m_LastValue = value;
+    }
+
+    // Audio to control, take the last sample of each sub-block
+    else if (m_Rate == Rate::CONTROL) {
+        const size_t size = a_Source.getSize();
+
+        for (size_t i=0, j=0; i<size; i+=CONTROL_PERIOD, ++j) {
+            dst[j] = src[std::min(i + CONTROL_PERIOD, size) - 1];
+        }
+    }
 }
 
 // ============================================================================
@@ -230,8 +318,8 @@ Audio::Buffer<float>& Port::getBuffer () {
     // Proxy port
     else if (m_Type == Type::PROXY) {
 
-        // Return buffer of the connected port
-        if (m_SourcePort != nullptr) {
+        // Return buffer of the connected port unless it needs conversion
+        if (m_SourcePort != nullptr && m_SourcePort->m_Rate == m_Rate) {
             return m_SourcePort->getBuffer();
         }
 
@@ -265,10 +353,21 @@ const Audio::Buffer<float>& Port::process () {
 
         // Process the buffer on the connected upstream port
         if (m_SourcePort != nullptr) {
-            return m_SourcePort->process();
+            auto& buffer = m_SourcePort->process();
+
+            // Same rate, pass it through
+            if (m_SourcePort->m_Rate == m_Rate) {
+                return buffer;
+            }
+
+            // Convert once per processing cycle
+            if (m_IsDirty) {
+                convert(buffer);
+                m_IsDirty = false;
+            }
         }
 
-        // Not connected, return own buffer with constant data
+        // Not connected or converted, return own buffer
         return m_Buffer;
     }
 
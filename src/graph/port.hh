@@ -33,13 +33,23 @@ public:
         PROXY
     };
 
+    /// Port rate
+    enum class Rate {
+        AUDIO,      /// One value per sample
+        CONTROL     /// One value per CONTROL_PERIOD samples
+    };
+
+    /// Length of a control rate sub-block in samples. A control rate value
+    /// holds the signal at the last sample of its sub-block.
+    static constexpr size_t CONTROL_PERIOD = 16;
+
     /// Constructor (Buffered)
     Port (Module* a_Module, const std::string& a_Name,
-          Direction a_Direction);
+          Direction a_Direction, Rate a_Rate = Rate::AUDIO);
 
     /// Constructor (Proxy)
     Port (Module* a_Module, const std::string& a_Name,
-          Direction a_Direction, float a_Default);
+          Direction a_Direction, float a_Default, Rate a_Rate = Rate::AUDIO);
 
     /// Returns the owner module
     Module* getModule () const;
@@ -51,9 +61,16 @@ public:
     Direction getDirection () const;
     /// Returns port type
     Type getType () const;
+    /// Returns port rate
+    Rate getRate () const;
+    /// Returns the buffer length of the port for the given audio buffer size
+    size_t getBufferSize (size_t a_AudioSize) const;
 
     /// Returns true when the port is connected
     bool isConnected ();
+    /// Returns the buffered port a proxy port reads from, nullptr when there
+    /// is none
+    Port* getSource () const;
 
     /// Returns the buffer dirty flag.
     bool isDirty    ();
@@ -65,15 +82,22 @@ public:
     /// Returns the buffer associated with the port.
     Audio::Buffer<float>& getBuffer ();
     /// Returns buffer associated with the port. Invokes processing in all
-    /// upstream modules if necessary.
+    /// upstream modules if necessary. A proxy port connected to a port of a
+    /// different rate returns its own buffer with the signal converted to
+    /// its rate.
     const Audio::Buffer<float>& process ();
 
 protected:
 
+    /// Converts the buffer of the source port to the rate of this one
+    void convert (const Audio::Buffer<float>& a_Source);
+
     /// Updates source and sink lists
     void updateSourcesAndSinks ();
     /// Sets a new audio buffer to be associated with the port
     void setBuffer (const Audio::Buffer<float>& a_Buffer);
+    /// Forgets the signal history, called when the module starts
+    void reset ();
 
     // ....................................................
     
@@ -86,14 +110,22 @@ protected:
     const Direction m_Direction;
     /// Port type
     const Type m_Type;
+    /// Port rate
+    const Rate m_Rate;
 
     /// Default signal value
     const float m_Default;
     /// Audio buffer
     Audio::Buffer<float> m_Buffer;
-    /// Dirty flag
+    /// Dirty flag. For a proxy port tells that the converted signal is
+    /// out of date.
     bool m_IsDirty = true;
 
+    /// Last control value of the previous buffer, used for interpolation
+    float m_LastValue = 0.0f;
+    /// Set when m_LastValue holds a valid value
+    bool  m_HasLastValue = false;
+
     /// Connected source port (upstream)
     Port* m_SourcePort = nullptr;
     /// Connected sink ports (downstream)
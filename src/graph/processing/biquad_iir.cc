@@ -17,50 +17,119 @@ BiquadIIR::BiquadIIR (const Coeffs& a_Coeffs) {
 // ============================================================================
 
 void BiquadIIR::setCoeffs (const Coeffs& a_Coeffs) {
-
-    // Store
-    m_Coeffs = a_Coeffs;
-
-    // Normalize
-    m_Coeffs.b2 /= m_Coeffs.a0;
-    m_Coeffs.b1 /= m_Coeffs.a0;
-    m_Coeffs.b0 /= m_Coeffs.a0;
-    m_Coeffs.a2 /= m_Coeffs.a0;
-    m_Coeffs.a1 /= m_Coeffs.a0;
-    m_Coeffs.a0  = 1.0f;
+    m_Coeffs = normalize(a_Coeffs);
 }
 
 void BiquadIIR::reset () {
 
     // Reset the state vector
-    m_State.w1 = 0.0f;
-    m_State.w2 = 0.0f;
+    m_State.s1 = 0.0f;
+    m_State.s2 = 0.0f;
+}
+
+BiquadIIR::Coeffs BiquadIIR::normalize (const Coeffs& a_Coeffs) {
+
+    Coeffs cf = a_Coeffs;
+    float  k  = 1.0f / cf.a0;
+
+    cf.b2 *= k;
+    cf.b1 *= k;
+    cf.b0 *= k;
+    cf.a2 *= k;
+    cf.a1 *= k;
+    cf.a0  = 1.0f;
+
+    return cf;
 }
 
 // ============================================================================
 
 float BiquadIIR::process (float a_Sample) {
 
-    // Recursive part
-    float w =  (a_Sample - m_Coeffs.a1 * m_State.w1 - m_Coeffs.a2 * m_State.w2);
-
-    // FIR part
-    float y = \
-        (m_Coeffs.b0 * w + m_Coeffs.b1 * m_State.w1 + m_Coeffs.b2 * m_State.w2);
+    float y = m_Coeffs.b0 * a_Sample + m_State.s1;
 
     // Update the state vector
-    m_State.w2 = m_State.w1;
-    m_State.w1 = w;
+    m_State.s1 = m_Coeffs.b1 * a_Sample - m_Coeffs.a1 * y + m_State.s2;
+    m_State.s2 = m_Coeffs.b2 * a_Sample - m_Coeffs.a2 * y;
 
     return y;
 }
 
 void BiquadIIR::process (float* a_Out, const float* a_In, size_t a_Length) {
 
-    // Process a whole buffer
+    // Keep everything in registers
+    const float b0 = m_Coeffs.b0;
+    const float b1 = m_Coeffs.b1;
+    const float b2 = m_Coeffs.b2;
+    const float a1 = m_Coeffs.a1;
+    const float a2 = m_Coeffs.a2;
+
+    float s1 = m_State.s1;
+    float s2 = m_State.s2;
+
     for (size_t i=0; i<a_Length; ++i) {
-        *a_Out++ = process(*a_In++);
+        float x = a_In[i];
+        float y = b0 * x + s1;
+
+        s1 = b1 * x - a1 * y + s2;
+        s2 = b2 * x - a2 * y;
+
+        a_Out[i] = y;
     }
+
+    m_State.s1 = s1;
+    m_State.s2 = s2;
+}
+
+void BiquadIIR::process (float* a_Out, const float* a_In, size_t a_Length,
+                         const Coeffs& a_Coeffs)
+{
+    if (a_Length == 0) {
+        return;
+    }
+
+    // Target coefficients and per-sample steps. Interpolating between two
+    // stable filters keeps the filter stable since the stability region
+    // of (a1, a2) is convex.
+    const Coeffs target = normalize(a_Coeffs);
+    const float  k      = 1.0f / (float)a_Length;
+
+    const float db0 = (target.b0 - m_Coeffs.b0) * k;
+    const float db1 = (target.b1 - m_Coeffs.b1) * k;
+    const float db2 = (target.b2 - m_Coeffs.b2) * k;
+    const float da1 = (target.a1 - m_Coeffs.a1) * k;
+    const float da2 = (target.a2 - m_Coeffs.a2) * k;
+
+    float b0 = m_Coeffs.b0;
+    float b1 = m_Coeffs.b1;
+    float b2 = m_Coeffs.b2;
+    float a1 = m_Coeffs.a1;
+    float a2 = m_Coeffs.a2;
+
+    float s1 = m_State.s1;
+    float s2 = m_State.s2;
+
+    for (size_t i=0; i<a_Length; ++i) {
+        b0 += db0;
+        b1 += db1;
+        b2 += db2;
+        a1 += da1;
+        a2 += da2;
+
+        float x = a_In[i];
+        float y = b0 * x + s1;
+
+        s1 = b1 * x - a1 * y + s2;
+        s2 = b2 * x - a2 * y;
+
+        a_Out[i] = y;
+    }
+
+    m_State.s1 = s1;
+    m_State.s2 = s2;
+
+    // Land exactly on the target
+    m_Coeffs = target;
 }
 
 // ============================================================================
@@ -9,6 +9,8 @@ namespace Processing {
 
 // ============================================================================
 
+/// A biquad IIR filter in the transposed direct form II. The form keeps the
+/// state well behaved when coefficients change while processing.
 class BiquadIIR {
 public:
 
@@ -18,6 +20,10 @@ public:
         float b0, b1, b2;
     };
 
+    /// Coefficient computation function type. Takes the frequency [Hz],
+    /// gain [dB], Q and the sample rate.
+    typedef const Coeffs (*ComputeFunction)(float, float, float, float);
+
     /// Default constructor
     BiquadIIR () = default;
     /// Constructs using given coefficients
@@ -30,6 +36,11 @@ public:
 
     /// Process an audio buffer
     void  process (float* a_Out, const float* a_In, size_t a_Length);
+    /// Processes an audio buffer while linearly interpolating coefficients
+    /// from the current ones to the given ones. The last sample uses the new
+    /// coefficients which remain set afterwards.
+    void  process (float* a_Out, const float* a_In, size_t a_Length,
+                   const Coeffs& a_Coeffs);
     /// Processes a single sample
     float process (float a_Sample);
 
@@ -51,6 +62,9 @@ public:
     /// Compute a high shelving filter
     static const Coeffs computeHighShelf (float f0, float gain, float Q, float fs);
 
+    /// Returns coefficients normalized so that a0 = 1
+    static Coeffs normalize (const Coeffs& a_Coeffs);
+
 private:
 
     /// Coefficients
@@ -58,8 +72,8 @@ private:
 
     /// State vector
     struct {
-        float w1 = 0.0f;
-        float w2 = 0.0f;
+        float s1 = 0.0f;
+        float s2 = 0.0f;
     } m_State;
 };
 
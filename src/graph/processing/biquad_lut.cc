@@ -0,0 +1,208 @@
+#include "biquad_lut.hh"
+
+#include <utils/utils.hh>
+#include <utils/math.hh>
+
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#include <cmath>
+
+namespace Graph {
+namespace Processing {
+
+// ============================================================================
+
+std::shared_ptr<const BiquadLUT> BiquadLUT::get (Function a_Function,
+                                                 bool  a_UsesGain,
+                                                 float a_SampleRate,
+                                                 size_t a_Resolution)
+{
+    typedef std::tuple<Function, float, size_t> Key;
+
+    static std::mutex mutex;
+    static std::map<Key, std::shared_ptr<const BiquadLUT>> cache;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Already built
+    Key key (a_Function, a_SampleRate, a_Resolution);
+    auto itr = cache.find(key);
+    if (itr != cache.end()) {
+        return itr->second;
+    }
+
+    // Build
+    std::shared_ptr<const BiquadLUT> table (
+        new BiquadLUT(a_Function, a_UsesGain, a_SampleRate, a_Resolution)
+    );
+    cache[key] = table;
+
+    return table;
+}
+
+// ============================================================================
+
+namespace {
+
+/// Weighted sum of normalized coefficients. Kept in registers, the result
+/// is stored once.
+struct Accumulator {
+    float a1 = 0.0f;
+    float a2 = 0.0f;
+    float b0 = 0.0f;
+    float b1 = 0.0f;
+    float b2 = 0.0f;
+
+    /// Adds weighted coefficients
+    inline void add (const BiquadIIR::Coeffs& a_Cf, float a_Weight) {
+        a1 += a_Weight * a_Cf.a1;
+        a2 += a_Weight * a_Cf.a2;
+        b0 += a_Weight * a_Cf.b0;
+        b1 += a_Weight * a_Cf.b1;
+        b2 += a_Weight * a_Cf.b2;
+    }
+};
+
+/// Maps a value to a grid position, returns the index of the lower grid
+/// point and stores the interpolation weight. The scale is the reciprocal of
+/// the grid step.
+inline size_t locate (float a_Value, float a_Min, float a_Scale,
+                      size_t a_Count, float* a_Weight)
+{
+    // Clamp
+    float x = (a_Value - a_Min) * a_Scale;
+    float m = (float)(a_Count - 1);
+
+    x = (x < 0.0f) ? 0.0f : x;
+    x = (x > m)    ? m    : x;
+
+    // Keep the upper point inside the grid
+    int32_t i = (int32_t)x;
+    int32_t n = (int32_t)a_Count - 2;
+    i = (i > n) ? n : i;
+
+    *a_Weight = x - (float)i;
+    return (size_t)i;
+}
+
+}; // Anonymous
+
+// ============================================================================
+
+BiquadLUT::BiquadLUT (Function a_Function, bool a_UsesGain,
+                      float a_SampleRate, size_t a_Resolution)
+{
+    if (a_Resolution < 1) {
+        a_Resolution = 1;
+    }
+
+    // CV grid, linear in octaves
+    const float cvStep = 1.0f / (float)a_Resolution;
+
+    m_CvScale = 1.0f / cvStep;
+    m_CvCount = (size_t)ceilf((CV_MAX - CV_MIN) / cvStep) + 1;
+
+    // Q grid, linear in octaves
+    const float qStep = 4.0f / (float)a_Resolution;
+    const float qMax  = log2f(Q_MAX);
+
+    m_QMin   = log2f(Q_MIN);
+    m_QScale = 1.0f / qStep;
+    m_QCount = (size_t)ceilf((qMax - m_QMin) / qStep) + 1;
+
+    // Gain grid
+    const float gainStep = GAIN_STEP / (float)a_Resolution;
+
+    m_GainScale = 1.0f / gainStep;
+    m_GainCount = 1;
+    if (a_UsesGain) {
+        m_GainCount = (size_t)ceilf((GAIN_MAX - GAIN_MIN) / gainStep) + 1;
+    }
+
+    // Compute
+    m_Data.resize(m_GainCount * m_QCount * m_CvCount);
+    auto ptr = m_Data.begin();
+
+    for (size_t k=0; k<m_GainCount; ++k) {
+        float gain = a_UsesGain ? GAIN_MIN + k * gainStep : 0.0f;
+
+        for (size_t j=0; j<m_QCount; ++j) {
+            float q = exp2f(m_QMin + j * qStep);
+
+            for (size_t i=0; i<m_CvCount; ++i) {
+                float f = Utils::cvToFrequency(CV_MIN + i * cvStep);
+                *ptr++  = BiquadIIR::normalize(
+                    a_Function(f, gain, q, a_SampleRate)
+                );
+            }
+        }
+    }
+}
+
+// ============================================================================
+
+BiquadIIR::Coeffs BiquadLUT::lookup (float a_Cv, float a_Gain,
+                                     float a_Q) const
+{
+    float wc, wq;
+
+    size_t ic = locate(a_Cv, CV_MIN, m_CvScale, m_CvCount, &wc);
+    size_t iq = locate(Utils::Math::fastLog2(a_Q), m_QMin, m_QScale,
+                       m_QCount, &wq);
+
+    // Bilinear weights
+    float w00 = (1.0f - wq) * (1.0f - wc);
+    float w01 = (1.0f - wq) * wc;
+    float w10 = wq * (1.0f - wc);
+    float w11 = wq * wc;
+
+    const size_t plane = m_QCount * m_CvCount;
+    const BiquadIIR::Coeffs* p0 = &m_Data[iq * m_CvCount + ic];
+    const BiquadIIR::Coeffs* p1 = p0 + m_CvCount;
+
+    Accumulator acc;
+
+    // Gain dependent, interpolate between two planes
+    if (m_GainCount > 1) {
+        float  wg;
+        size_t ig = locate(a_Gain, GAIN_MIN, m_GainScale, m_GainCount, &wg);
+
+        p0 += ig * plane;
+        p1 += ig * plane;
+
+        acc.add(p0[0], w00 * (1.0f - wg));
+        acc.add(p0[1], w01 * (1.0f - wg));
+        acc.add(p1[0], w10 * (1.0f - wg));
+        acc.add(p1[1], w11 * (1.0f - wg));
+
+        p0 += plane;
+        p1 += plane;
+
+        w00 *= wg;
+        w01 *= wg;
+        w10 *= wg;
+        w11 *= wg;
+    }
+
+    acc.add(p0[0], w00);
+    acc.add(p0[1], w01);
+    acc.add(p1[0], w10);
+    acc.add(p1[1], w11);
+
+    BiquadIIR::Coeffs cf;
+    cf.a0 = 1.0f;
+    cf.a1 = acc.a1;
+    cf.a2 = acc.a2;
+    cf.b0 = acc.b0;
+    cf.b1 = acc.b1;
+    cf.b2 = acc.b2;
+
+    return cf;
+}
+
+// ============================================================================
+
+}; // Processing
+}; // Graph
@@ -0,0 +1,80 @@
+#ifndef GRAPH_PROCESSING_BIQUAD_LUT_HH
+#define GRAPH_PROCESSING_BIQUAD_LUT_HH
+
+#include "biquad_iir.hh"
+
+#include <vector>
+#include <memory>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Graph {
+namespace Processing {
+
+// ============================================================================
+
+/// A precomputed table of normalized biquad coefficients for a single filter
+/// type and sample rate. Indexed by the frequency CV, Q and, for filter types
+/// that depend on it, gain. Coefficients in between grid points are linearly
+/// interpolated which keeps the filter stable. Tables are immutable, built
+/// once on first request and shared by all users.
+class BiquadLUT {
+public:
+
+    /// Coefficient computation function type
+    typedef BiquadIIR::ComputeFunction Function;
+
+    /// Frequency CV range covered. Values outside are clamped.
+    static constexpr float CV_MIN   = -2.0f;
+    static constexpr float CV_MAX   = 10.0f;
+    /// Q range covered. Values outside are clamped.
+    static constexpr float Q_MIN    =  0.1f;
+    static constexpr float Q_MAX    = 20.0f;
+    /// Gain range covered [dB]. Values outside are clamped.
+    static constexpr float GAIN_MIN = -24.0f;
+    static constexpr float GAIN_MAX = +24.0f;
+    /// Gain grid step [dB] at resolution 1
+    static constexpr float GAIN_STEP = 32.0f;
+
+    /// Returns a shared table for the given filter type and sample rate. The
+    /// resolution is the number of grid points per octave of the cutoff
+    /// frequency, Q uses a quarter of that per octave and gain a step of
+    /// GAIN_STEP / resolution dB. Gain is tabulated only if the filter type
+    /// uses it.
+    static std::shared_ptr<const BiquadLUT> get (Function a_Function,
+                                                 bool  a_UsesGain,
+                                                 float a_SampleRate,
+                                                 size_t a_Resolution);
+
+    /// Returns interpolated normalized coefficients
+    BiquadIIR::Coeffs lookup (float a_Cv, float a_Gain, float a_Q) const;
+
+protected:
+
+    /// Builds the table
+    BiquadLUT (Function a_Function, bool a_UsesGain, float a_SampleRate,
+               size_t a_Resolution);
+
+    /// Grid scales (reciprocals of steps)
+    float  m_CvScale;
+    float  m_QScale;
+    float  m_GainScale;
+    /// Q grid start (log2)
+    float  m_QMin;
+
+    /// Grid point counts
+    size_t m_CvCount;
+    size_t m_QCount;
+    size_t m_GainCount;
+
+    /// Table data, gain major, then Q, then CV
+    std::vector<BiquadIIR::Coeffs> m_Data;
+};
+
+// ============================================================================
+
+}; // Processing
+}; // Graph
+
+#endif // GRAPH_PROCESSING_BIQUAD_LUT_HH
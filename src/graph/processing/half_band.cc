@@ -0,0 +1,142 @@
+#include "half_band.hh"
+
+#include <utils/math.hh>
+
+#include <algorithm>
+
+#include <cassert>
+#include <cmath>
+
+namespace Graph {
+namespace Processing {
+
+// ============================================================================
+
+namespace {
+
+/// Kaiser window shape parameter, about 80dB of stopband attenuation
+constexpr double KAISER_BETA = 8.0;
+
+}; // Anonymous
+
+// ============================================================================
+
+HalfBand::HalfBand (size_t a_Order) :
+    m_Order (a_Order | 1)
+{
+    const int32_t M = (int32_t)m_Order;
+
+    // Windowed sinc with the cutoff at a quarter of the sample rate. Only
+    // odd taps are non-zero, the center one is 0.5.
+    m_Taps.resize(m_Order + 1);
+    double sum = 0.0;
+
+    for (int32_t k=0; k<=M; ++k) {
+        int32_t n = 2 * k - M;
+        double  h = 0.5 * Utils::Math::sinc(0.5 * n) *
+                    Utils::Math::kaiser((double)n / (double)(M + 1), KAISER_BETA);
+
+        m_Taps[k] = (float)h;
+        sum += h;
+    }
+
+    // Make the off-center taps sum up to exactly 0.5 for unity DC gain
+    for (auto& tap : m_Taps) {
+        tap = (float)(tap * 0.5 / sum);
+    }
+}
+
+// ============================================================================
+
+void HalfBand::prepare (size_t a_MaxSize) {
+    m_Even.resize(m_Order + a_MaxSize);
+    m_Odd.resize((m_Order + 1) / 2 + a_MaxSize);
+    reset();
+}
+
+void HalfBand::reset () {
+    std::fill(m_Even.begin(), m_Even.end(), 0.0f);
+    std::fill(m_Odd.begin(),  m_Odd.end(),  0.0f);
+}
+
+// ============================================================================
+
+void HalfBand::interpolate (const float* a_Input, float* a_Output,
+                            size_t a_Count)
+{
+    assert(m_Order + a_Count <= m_Even.size());
+
+    const size_t M = m_Order;
+    const size_t D = (M - 1) / 2;
+    const size_t T = m_Taps.size();
+
+    float*       hist = m_Even.data();
+    const float* taps = m_Taps.data();
+
+    // Append the input to the history
+    std::copy(a_Input, a_Input + a_Count, hist + M);
+
+    // Even outputs come from the filtered phase, odd ones from the center tap
+    // which is a pure delay. The gain of 2 compensates for the zero stuffing.
+    for (size_t m=0; m<a_Count; ++m) {
+        const float* src = hist + m;
+
+        float acc = 0.0f;
+        for (size_t i=0; i<T; ++i) {
+            acc += taps[i] * src[i];
+        }
+
+        a_Output[2 * m]     = 2.0f * acc;
+        a_Output[2 * m + 1] = src[M - D];
+    }
+
+    // Keep the history
+    std::copy(hist + a_Count, hist + a_Count + M, hist);
+}
+
+void HalfBand::decimate (const float* a_Input, float* a_Output,
+                         size_t a_Count)
+{
+    assert(m_Order + a_Count <= m_Even.size());
+
+    const size_t M = m_Order;
+    const size_t H = (M + 1) / 2;
+    const size_t T = m_Taps.size();
+
+    float*       even = m_Even.data();
+    float*       odd  = m_Odd.data();
+    const float* taps = m_Taps.data();
+
+    // Split the input into even and odd samples after the history
+    for (size_t m=0; m<a_Count; ++m) {
+        even[M + m] = a_Input[2 * m];
+        odd [H + m] = a_Input[2 * m + 1];
+    }
+
+    // Filter even samples, odd samples only go through the center tap
+    for (size_t m=0; m<a_Count; ++m) {
+        const float* src = even + m;
+
+        float acc = 0.0f;
+        for (size_t i=0; i<T; ++i) {
+            acc += taps[i] * src[i];
+        }
+
+        a_Output[m] = acc + 0.5f * odd[m];
+    }
+
+    // Keep the history
+    std::copy(even + a_Count, even + a_Count + M, even);
+    std::copy(odd  + a_Count, odd  + a_Count + H, odd);
+}
+
+// ============================================================================
+
+size_t HalfBand::getMemoryUsage () const {
+    return (m_Taps.size() + m_Even.size() + m_Odd.size()) * sizeof(float);
+}
+
+// ============================================================================
+
+}; // Processing
+}; // Graph
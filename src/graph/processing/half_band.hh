@@ -0,0 +1,61 @@
+#ifndef GRAPH_PROCESSING_HALF_BAND_HH
+#define GRAPH_PROCESSING_HALF_BAND_HH
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Graph {
+namespace Processing {
+
+// ============================================================================
+
+/// A half-band FIR filter for changing the sample rate by a factor of 2.
+/// Every other tap of a half-band filter is zero except the center one so
+/// in the polyphase form one of the phases is a pure delay and only the
+/// other one needs to be computed. An instance holds state for a single
+/// direction, either interpolation or decimation.
+class HalfBand {
+public:
+
+    /// Creates a filter with 2 * a_Order + 1 taps. The order must be odd.
+    /// Larger orders give a narrower transition band around a quarter of
+    /// the higher sample rate.
+    HalfBand (size_t a_Order = 31);
+
+    /// Allocates buffers for blocks of up to the given number of samples at
+    /// the lower rate and resets the state.
+    void prepare (size_t a_MaxSize);
+    /// Resets the state
+    void reset ();
+
+    /// Upsamples a block. Produces 2 * a_Count samples.
+    void interpolate (const float* a_Input, float* a_Output, size_t a_Count);
+    /// Downsamples a block of 2 * a_Count samples. Produces a_Count samples.
+    void decimate    (const float* a_Input, float* a_Output, size_t a_Count);
+
+    /// Returns the memory used by taps and working buffers in bytes
+    size_t getMemoryUsage () const;
+
+protected:
+
+    /// Filter order (half length)
+    size_t m_Order;
+
+    /// Non-zero off-center taps in reverse order, DC gain of 0.5
+    std::vector<float> m_Taps;
+
+    /// Working buffers holding history followed by the current block. For
+    /// interpolation only the even one is used. For decimation the input
+    /// is split into even and odd samples.
+    std::vector<float> m_Even;
+    std::vector<float> m_Odd;
+};
+
+// ============================================================================
+
+}; // Processing
+}; // Graph
+
+#endif // GRAPH_PROCESSING_HALF_BAND_HH
@@ -7,15 +7,127 @@
 
 #include <sndfile.h>
 
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <tuple>
+
 #include <cmath>
-#include <cassert>
+#include <cstring>
 
 namespace Graph {
 namespace Processing {
 
 // ============================================================================
 
-void Sampler::load (const std::string& a_FileName) {
+#define _PI 3.141592653589793
+
+namespace {
+
+/// Kaiser window shape parameter of the interpolator
+constexpr double  KAISER_BETA = 6.0;
+
+/// Returns the polyphase interpolator table. There are PHASES rows of TAPS
+/// coefficients followed by TAPS differences to the next row for linear
+/// interpolation in between phases. Built once on first use.
+const float* getInterpolator () {
+
+    static const std::vector<float> table = [] {
+        const size_t T = Sampler::TAPS;
+        const size_t P = Sampler::PHASES;
+        const double R = (double)T / 2.0;
+
+        // Compute windowed sinc rows including the one for phase 1.0
+        std::vector<double> rows ((P + 1) * T);
+        for (size_t p=0; p<=P; ++p) {
+            double frac = (double)p / (double)P;
+            double sum  = 0.0;
+
+            for (size_t k=0; k<T; ++k) {
+                double x = (double)k - (R - 1.0) - frac;
+                double w = Utils::Math::kaiser(x / R, KAISER_BETA);
+
+                rows[p * T + k] = Utils::Math::sinc(x) * w;
+                sum += rows[p * T + k];
+            }
+
+            // Unity DC gain for each phase
+            for (size_t k=0; k<T; ++k) {
+                rows[p * T + k] /= sum;
+            }
+        }
+
+        // Store coefficients and differences
+        std::vector<float> data (P * 2 * T);
+        for (size_t p=0; p<P; ++p) {
+            for (size_t k=0; k<T; ++k) {
+                data[p * 2 * T + k]     = (float)rows[p * T + k];
+                data[p * 2 * T + T + k] = (float)(rows[(p + 1) * T + k] -
+                                                  rows[p * T + k]);
+            }
+        }
+
+        return data;
+    }();
+
+    return table.data();
+}
+
+}; // Anonymous
+
+// ============================================================================
+
+std::shared_ptr<const Sampler> Sampler::get (const std::string& a_FileName,
+                                             bool   a_Loop,
+                                             size_t a_LoopStart,
+                                             size_t a_LoopEnd)
+{
+    typedef std::tuple<std::string, bool, size_t, size_t> Key;
+
+    static std::mutex mutex;
+    static std::map<Key, std::shared_ptr<const Sampler>> cache;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // The layout depends on the loop
+    if (!a_Loop) {
+        a_LoopStart = 0;
+        a_LoopEnd   = 0;
+    }
+
+    // Already loaded
+    const Key key (a_FileName, a_Loop, a_LoopStart, a_LoopEnd);
+
+    auto itr = cache.find(key);
+    if (itr != cache.end()) {
+        return itr->second;
+    }
+
+    // Load
+    std::shared_ptr<const Sampler> sampler (
+        new Sampler(a_FileName, a_Loop, a_LoopStart, a_LoopEnd)
+    );
+    cache[key] = sampler;
+
+    return sampler;
+}
+
+// ============================================================================
+
+Sampler::Sampler (const std::string& a_FileName, bool a_Loop,
+                  size_t a_LoopStart, size_t a_LoopEnd)
+{
+    // Load the waveform
+    auto wave = load(a_FileName);
+
+    // Lay it out
+    setLoop(a_FileName, wave.size(), a_Loop, a_LoopStart, a_LoopEnd);
+
+    // Build mip-map levels
+    buildLevels(wave);
+}
+
+std::vector<float> Sampler::load (const std::string& a_FileName) {
 
     // Open the audio file
     SF_INFO info;
@@ -39,83 +151,213 @@ void Sampler::load (const std::string& a_FileName) {
 
     // Get the file size
     sf_count_t numFrames = sf_seek(sf, 0, SEEK_END);
+    if (numFrames < 1) {
+        sf_close(sf);
+        THROW(std::runtime_error, "The audio file '%s' is empty", a_FileName.c_str());
+    }
 
     // Allocate a temporary buffer
-    size_t bufferSize = numFrames * info.channels * sizeof(float);
-    std::unique_ptr<float> buffer(new float[bufferSize]);
+    std::vector<float> buffer (numFrames * info.channels);
 
     sf_command(sf, SFC_SET_NORM_FLOAT, NULL, SF_TRUE);
 
     // Read data and close the file
     sf_seek(sf, 0, SEEK_SET);
-    sf_count_t read = sf_readf_float(sf, buffer.get(), numFrames);
+    sf_count_t read = sf_readf_float(sf, buffer.data(), numFrames);
     sf_close(sf);
 
     if (read < numFrames) {
         THROW(std::runtime_error, "Error reading audio file '%s'", a_FileName.c_str());
     }
 
-    // Create the buffer with magins
-    m_Waveform.create(numFrames + 2*MARGIN, info.channels);
+    // Store info
+    m_SampleRate = info.samplerate;
 
-    // Copy data. Deinterleave samples and create margins for regular sample
-    // lookup during interpolation.
-    for (size_t c=0; c<m_Waveform.getChannels(); ++c) {
-        const float* src = buffer.get() + c;
-        float*       dst = m_Waveform.data(c);
-        size_t       dj  = m_Waveform.getChannels();
+    return buffer;
+}
 
-        for (int32_t i=0; i<(int32_t)m_Waveform.getSize(); ++i) {
-            int32_t j = i - MARGIN;
+void Sampler::setLoop (const std::string& a_FileName, size_t a_FileSize,
+                       bool a_Loop, size_t a_LoopStart, size_t a_LoopEnd)
+{
+    m_Loop = a_Loop;
+
+    // One-shot, silence around
+    if (!m_Loop) {
+        m_Size      = a_FileSize;
+        m_LoopStart = 0;
+        m_LoopEnd   = m_Size;
+        return;
+    }
 
-            // Wrap around
-            if (j < 0) {
-                j += numFrames;
-            }
-            if (j >= numFrames) {
-                j -= numFrames;
+    // Check loop points
+    if (a_LoopEnd == 0) {
+        a_LoopEnd = a_FileSize;
+    }
+
+    if (a_LoopEnd <= a_LoopStart || a_LoopEnd > a_FileSize) {
+        THROW(std::runtime_error, "Invalid loop %zu-%zu for audio file '%s'",
+            a_LoopStart, a_LoopEnd, a_FileName.c_str());
+    }
+
+    // The waveform is played up to the loop end, then the loop repeats.
+    // Move the loop points past the reach of the level filters and the
+    // interpolator so that they see only the loop after a wrap.
+    const size_t shift = FILTER_REACH + MARGIN;
+
+    m_FileLoopStart = a_LoopStart;
+    m_LoopStart     = a_LoopStart + shift;
+    m_LoopEnd       = a_LoopEnd   + shift;
+    m_Size          = m_LoopEnd;
+}
+
+float Sampler::getSample (const std::vector<float>& a_Wave,
+                          int64_t a_Pos) const
+{
+    // Silence before the start
+    if (a_Pos < 0) {
+        return 0.0f;
+    }
+
+    // One-shot, silence after the end
+    if (!m_Loop) {
+        return (a_Pos < (int64_t)a_Wave.size()) ? a_Wave[a_Pos] : 0.0f;
+    }
+
+    // Looped, the loop repeats after its end
+    const int64_t loopStart  = (int64_t)m_FileLoopStart;
+    const int64_t loopLength = (int64_t)(m_LoopEnd - m_LoopStart);
+    const int64_t loopEnd    = loopStart + loopLength;
+
+    if (a_Pos < loopEnd) {
+        return a_Wave[a_Pos];
+    }
+
+    return a_Wave[loopStart + (a_Pos - loopEnd) % loopLength];
+}
+
+void Sampler::buildLevels (const std::vector<float>& a_Wave) {
+
+    // Half length of the level low-pass filter
+    const int32_t half = (int32_t)FILTER_HALF;
+    // Level low-pass filter cutoff relative to the sample rate. Placed so
+    // that the transition band ends at a quarter of the sample rate.
+    const double cutoff = 0.25 - 2.75 / (2 * half + 1);
+
+    // Design the low-pass filter
+    std::vector<float> filter (2 * half + 1);
+    double sum = 0.0;
+
+    for (int32_t t=-half; t<=half; ++t) {
+        double x = (double)t / (double)(2 * half + 2);
+        double w = 0.42 + 0.5 * cos(2.0 * _PI * x) + 0.08 * cos(4.0 * _PI * x);
+        double h = 2.0 * cutoff * Utils::Math::sinc(2.0 * cutoff * t) * w;
+
+        filter[t + half] = (float)h;
+        sum += h;
+    }
+
+    for (auto& h : filter) {
+        h = (float)(h / sum);
+    }
+
+    // Level 0 as played, padded by the total reach of the level filters on
+    // both sides
+    const int32_t pad    = (int32_t)(MARGIN + FILTER_REACH);
+    const int32_t length = (int32_t)m_Size + 2 * pad;
+
+    std::vector<float> src (length);
+    std::vector<float> dst (length, 0.0f);
+
+    for (int32_t i=0; i<length; ++i) {
+        src[i] = getSample(a_Wave, (int64_t)i - pad);
+    }
+
+    // Store a level with its margins
+    const size_t stride = m_Size + 2 * MARGIN;
+    m_Data.resize(LEVELS * stride);
+
+    auto store = [&](size_t a_Level, const std::vector<float>& a_Src) {
+        std::copy(a_Src.begin() + (pad - MARGIN),
+                  a_Src.begin() + (pad - MARGIN) + stride,
+                  m_Data.begin() + a_Level * stride);
+    };
+
+    store(0, src);
+
+    // Each level is made by filtering the previous one. The filter taps are
+    // spread apart by 2^(l-1) which halves its cutoff frequency. Its images
+    // fall above the bandwidth of the previous level so they have no effect.
+    // The valid part of the padded data shrinks by the filter reach on each
+    // level, it still covers the margins on the last one.
+    for (size_t l=1; l<LEVELS; ++l) {
+        const int32_t d     = 1 << (l - 1);
+        const int32_t reach = half * d;
+
+        for (int32_t i=reach; i<length-reach; ++i) {
+            double y = 0.0;
+
+            for (int32_t t=-half; t<=half; ++t) {
+                y += filter[t + half] * src[i + t * d];
             }
 
-            *dst++ = src[j * dj];
+            dst[i] = (float)y;
         }
+
+        store(l, dst);
+        std::swap(src, dst);
     }
+}
 
-    // Store info
-    m_SampleRate = info.samplerate;
+// ============================================================================
+
+size_t Sampler::getLevel (float a_MaxStep) const {
+
+    // Level l is band-limited to 1/2^l of the Nyquist frequency so it is
+    // alias-free for read steps up to 2^l.
+    float x = fabsf(a_MaxStep);
+    if (x <= 1.0f) {
+        return 0;
+    }
+
+    int level = (int)ceilf(log2f(x));
+    if (level >= (int)LEVELS) {
+        return LEVELS - 1;
+    }
+
+    return (size_t)level;
 }
 
-float Sampler::getSample (const float& phi) {
-    assert(phi >= 0.0f);
-    assert(phi <= 1.0f);
+// ============================================================================
 
-    // Actual audio length
-    size_t length = m_Waveform.getSize() - 2 * MARGIN;
+void Sampler::render (size_t a_Level, const int32_t* a_Index,
+                      const float* a_Frac, const float* a_Gain,
+                      float* a_Output, size_t a_Count) const
+{
+    const float* data   = getData(a_Level) - (TAPS / 2 - 1);
+    const float* interp = getInterpolator();
 
-    // Break into integer and fraction
-    double  i_f;
-    float   f = modf(phi * length, &i_f);
-    size_t  i = (size_t)i_f;
+    for (size_t i=0; i<a_Count; ++i) {
 
-    // Actual audio pointer
-    const float* ptr = m_Waveform.data() + MARGIN + i;
+        // Get the interpolator phase and phase weight. The fraction may
+        // round up to 1.0 when converted from double.
+        float   p = a_Frac[i] * (float)PHASES;
+        int32_t q = std::min((int32_t)p, (int32_t)PHASES - 1);
+        float   w = p - (float)q;
 
-    // Compute coeffs
-    float fp2 = f * f;
-    float fd6 = f / 6.0f;
-    float fd2 = f / 2.0f;
+        const float* src  = data + a_Index[i];
+        const float* coef = interp + q * 2 * TAPS;
 
-    // Compute the sample
-    float sample = ptr[0] +
-        ptr[-1] * fd6 * (-fp2 + 3.0f * f - 2.0f) +
-        ptr[ 0] * fd2 * ( fp2 - 2.0f * f - 1.0f) +
-        ptr[ 1] * fd2 * (-fp2 + 1.0f * f + 2.0f) +
-        ptr[ 2] * fd6 * ( fp2            - 1.0f);
+        // Convolve. The fixed length loop is vectorized by the compiler.
+        float y = 0.0f;
+        for (size_t k=0; k<TAPS; ++k) {
+            y += src[k] * (coef[k] + w * coef[TAPS + k]);
+        }
 
-    return sample;
+        a_Output[i] = a_Gain[i] * y;
+    }
 }
 
 // ============================================================================
 
 }; // Processing
 }; // Graph
-
@@ -1,9 +1,9 @@
 #ifndef GRAPH_PROCESSING_SAMPLER_HH
 #define GRAPH_PROCESSING_SAMPLER_HH
 
-#include <audio/buffer.hh>
-
 #include <string>
+#include <vector>
+#include <memory>
 
 #include <cstddef>
 #include <cstdint>
@@ -13,36 +13,120 @@ namespace Processing {
 
 // ============================================================================
 
+/// A waveform loaded from an audio file. Level 0 holds the original data,
+/// each next level is low-pass filtered to half of the bandwidth of the
+/// previous one. All levels keep the original sample rate. Samples are read
+/// using a polyphase windowed-sinc interpolator. Instances are immutable,
+/// loaded once on first request and shared by all users.
+///
+/// The data is laid out as played: silence before the start and, for a
+/// one-shot waveform, after the end. A looped waveform is followed by
+/// repetitions of its loop, and its loop points are moved into them far
+/// enough that the interpolator and level filters of a wrapped position
+/// only see the loop. Playback wrapping from getLoopEnd() to getLoopStart()
+/// is therefore seamless on all levels.
 class Sampler {
 public:
 
-    /// Loads the waveform from an audio file
-    void load (const std::string& a_FileName);
+    /// Number of mip-map levels (octaves)
+    static constexpr size_t LEVELS = 8;
+    /// Number of interpolator taps
+    static constexpr size_t TAPS   = 8;
+    /// Number of interpolator phases
+    static constexpr size_t PHASES = 256;
+
+    /// Returns shared waveform data loaded from the given audio file. The
+    /// loop is given in samples of the file, a loop end of 0 means the end
+    /// of the file.
+    static std::shared_ptr<const Sampler> get (const std::string& a_FileName,
+                                               bool   a_Loop      = false,
+                                               size_t a_LoopStart = 0,
+                                               size_t a_LoopEnd   = 0);
 
     /// Returns sample rate of the waveform in Hz
     float getSampleRate () const {
         return (float)m_SampleRate;
     }
 
-    /// Returns length of the waveform in seconds
-    float getLength () const {
-        size_t length = m_Waveform.getSize() - 2 * MARGIN;
-        return (float)length / (float)m_SampleRate;
+    /// Returns length of the waveform data in samples, including loop
+    /// repetitions
+    size_t getSize () const {
+        return m_Size;
+    }
+
+    /// Returns true when the waveform is looped
+    bool isLooped () const {
+        return m_Loop;
     }
 
-    /// Returns a single sample at the given point in time. The "phase" ranges
-    /// from 0.0 to 1.0
-    float getSample (const float& phi);
+    /// Returns the loop start in samples of the waveform data
+    size_t getLoopStart () const {
+        return m_LoopStart;
+    }
+
+    /// Returns the loop end in samples of the waveform data
+    size_t getLoopEnd () const {
+        return m_LoopEnd;
+    }
 
-private:
+    /// Returns the level suitable for the given maximal read step (in
+    /// waveform samples per output sample) so that the output is alias-free.
+    size_t getLevel (float a_MaxStep) const;
+
+    /// Renders a block. For each output sample reads the waveform at the
+    /// given position, split into a sample index [0, size) and a fraction
+    /// [0-1), and multiplies the result by the gain. Gain and output may
+    /// point to the same buffer.
+    void render (size_t a_Level, const int32_t* a_Index, const float* a_Frac,
+                 const float* a_Gain, float* a_Output, size_t a_Count) const;
+
+protected:
+
+    /// Loads the waveform from an audio file, lays it out and builds levels
+    Sampler (const std::string& a_FileName, bool a_Loop,
+             size_t a_LoopStart, size_t a_LoopEnd);
+
+    /// Loads the waveform from an audio file
+    std::vector<float> load (const std::string& a_FileName);
+    /// Sets up the data layout for the given loop in samples of the file
+    void setLoop (const std::string& a_FileName, size_t a_FileSize,
+                  bool a_Loop, size_t a_LoopStart, size_t a_LoopEnd);
+    /// Returns a sample of the waveform as played at the given position
+    /// of the data
+    float getSample (const std::vector<float>& a_Wave, int64_t a_Pos) const;
+    /// Builds all levels
+    void buildLevels (const std::vector<float>& a_Wave);
+
+    /// Returns a pointer to the first sample of the level data. Each level
+    /// has MARGIN samples before and after that continue the waveform as
+    /// played.
+    const float* getData (size_t a_Level) const {
+        return m_Data.data() + a_Level * (m_Size + 2 * MARGIN) + MARGIN;
+    }
 
     /// Margin size
-    static constexpr size_t MARGIN = 2;
+    static constexpr size_t MARGIN = TAPS;
+    /// Half length of the level low-pass filter
+    static constexpr size_t FILTER_HALF = 32;
+    /// Count of samples the level filters reach to either side in total
+    static constexpr size_t FILTER_REACH =
+        FILTER_HALF * ((1 << (LEVELS - 1)) - 1);
 
     /// Original waveform sample rate
     size_t m_SampleRate = 0;
-    /// The waveform
-    Audio::Buffer<float> m_Waveform;
+    /// Waveform data length in samples
+    size_t m_Size = 0;
+
+    /// Loop enable
+    bool   m_Loop = false;
+    /// Loop points in samples of the data
+    size_t m_LoopStart = 0;
+    size_t m_LoopEnd   = 0;
+    /// Loop start in samples of the file
+    size_t m_FileLoopStart = 0;
+
+    /// Waveform data for all levels
+    std::vector<float> m_Data;
 };
 
 // ============================================================================
@@ -0,0 +1,48 @@
+#include "svf.hh"
+
+#include <cmath>
+
+namespace Graph {
+namespace Processing {
+
+// ============================================================================
+
+SVF::Coeffs SVF::compute (float f0, float Q, float fs) {
+
+    // Keep the prewarped frequency finite
+    float w = f0 / fs;
+    if (w > 0.49f) w = 0.49f;
+    if (w < 0.0f)  w = 0.0f;
+
+    float g = tanf(3.14159265f * w);
+
+    Coeffs cf;
+    cf.k  = 1.0f / Q;
+    cf.a1 = 1.0f / (1.0f + g * (g + cf.k));
+    cf.a2 = g * cf.a1;
+    cf.a3 = g * cf.a2;
+
+    return cf;
+}
+
+float SVF::getButterworthQ (size_t a_Stages, size_t a_Stage) {
+
+    // Q = 1 / (2 * cos(theta)) for each pole pair of the prototype
+    static const float q1[] = {0.70710678f};
+    static const float q2[] = {0.54119610f, 1.30656296f};
+    static const float q4[] = {0.50979558f, 0.60134489f, 0.89997622f,
+                               2.56291545f};
+
+    switch (a_Stages)
+    {
+    case 1:  return q1[a_Stage];
+    case 2:  return q2[a_Stage];
+    case 4:  return q4[a_Stage];
+    default: return q1[0];
+    }
+}
+
+// ============================================================================
+
+}; // Processing
+}; // Graph
@@ -0,0 +1,72 @@
+#ifndef GRAPH_PROCESSING_SVF_HH
+#define GRAPH_PROCESSING_SVF_HH
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Graph {
+namespace Processing {
+
+// ============================================================================
+
+/// A state variable filter in the topology-preserving transform (TPT) form.
+/// Produces lowpass, bandpass and highpass outputs at once. Unlike a direct
+/// form biquad it stays well behaved under fast cutoff modulation. The class
+/// only holds the math, the state is kept by the caller so that cascades can
+/// be processed in a single loop with the state in registers.
+class SVF {
+public:
+
+    /// Filter coefficients
+    struct Coeffs {
+        float k;
+        float a1, a2, a3;
+    };
+
+    /// Filter state
+    struct State {
+        float ic1eq = 0.0f;
+        float ic2eq = 0.0f;
+    };
+
+    /// Filter outputs
+    struct Output {
+        float lp, bp, hp;
+    };
+
+    /// Maximum number of cascaded 2-pole stages
+    static constexpr size_t MAX_STAGES = 4;
+
+    /// Computes coefficients for the given frequency [Hz], Q and sample
+    /// rate. The frequency is limited below the Nyquist frequency.
+    static Coeffs compute (float f0, float Q, float fs);
+
+    /// Returns the Q of a stage of a Butterworth cascade of the given
+    /// number of 2-pole stages (1, 2 or 4).
+    static float getButterworthQ (size_t a_Stages, size_t a_Stage);
+
+    /// Processes a single sample
+    static inline Output tick (const Coeffs& c, State& s, float x) {
+
+        float v3 = x - s.ic2eq;
+        float v1 = c.a1 * s.ic1eq + c.a2 * v3;
+        float v2 = s.ic2eq + c.a2 * s.ic1eq + c.a3 * v3;
+
+        s.ic1eq = 2.0f * v1 - s.ic1eq;
+        s.ic2eq = 2.0f * v2 - s.ic2eq;
+
+        Output y;
+        y.lp = v2;
+        y.bp = v1;
+        y.hp = x - c.k * v1 - v2;
+
+        return y;
+    }
+};
+
+// ============================================================================
+
+}; // Processing
+}; // Graph
+
+#endif // GRAPH_PROCESSING_SVF_HH
@@ -75,6 +75,114 @@ float sawtooth (float x, float arg) {
     return 2.0f * (x - 0.5f);
 }
 
+// ============================================================================
+
+namespace {
+
+/// Returns the phase increment used for the correction. Clamped so that the
+/// residuals never divide by zero and never span more than a period.
+inline float getDelta (float inc) {
+    float dt = fabsf(inc);
+    dt = (dt < 1e-6f) ? 1e-6f : dt;
+    dt = (dt > 0.5f)  ? 0.5f  : dt;
+    return dt;
+}
+
+/// Wraps the phase to [0-1)
+inline float wrap (float x) {
+    return (x < 0.0f) ? x + 1.0f : x;
+}
+
+/// Two-sample polynomial band-limited step residual for a rising step of
+/// height 2 at t = 0. t is the phase [0-1), rdt the reciprocal of the phase
+/// increment. Written without branches so that block loops vectorize.
+inline float polyBlep (float t, float dt, float rdt) {
+    float a = t * rdt;
+    float b = (t - 1.0f) * rdt;
+
+    float ra = a + a - a * a - 1.0f;
+    float rb = b * b + b + b + 1.0f;
+
+    return (t < dt) ? ra : ((t > 1.0f - dt) ? rb : 0.0f);
+}
+
+/// Two-sample polynomial band-limited ramp residual, an integral of the
+/// polyBlep() one. Corrects a slope change of 2 per sample at t = 0.
+inline float polyBlamp (float t, float dt, float rdt) {
+    float a = t * rdt - 1.0f;
+    float b = (t - 1.0f) * rdt + 1.0f;
+
+    float ra = -(1.0f / 3.0f) * a * a * a;
+    float rb = +(1.0f / 3.0f) * b * b * b;
+
+    return (t < dt) ? ra : ((t > 1.0f - dt) ? rb : 0.0f);
+}
+
+}; // Anonymous
+
+// ============================================================================
+
+void polyblep_square (float* out, const float* phase, const float* inc,
+                      const float* arg, size_t n)
+{
+    for (size_t i=0; i<n; ++i) {
+        float x   = phase[i];
+        float d   = arg[i];
+        float dt  = getDelta(inc[i]);
+        float rdt = 1.0f / dt;
+
+        // Rising edge at 0, falling edge at the duty
+        float y = (x < d) ? +1.0f : -1.0f;
+        y += polyBlep(x, dt, rdt);
+        y -= polyBlep(wrap(x - d), dt, rdt);
+
+        out[i] = y;
+    }
+}
+
+void polyblep_sawtooth (float* out, const float* phase, const float* inc,
+                        const float* arg, size_t n)
+{
+    (void)arg;
+
+    for (size_t i=0; i<n; ++i) {
+        float x   = phase[i];
+        float dt  = getDelta(inc[i]);
+        float rdt = 1.0f / dt;
+
+        // Falling edge at 0
+        out[i] = 2.0f * (x - 0.5f) - polyBlep(x, dt, rdt);
+    }
+}
+
+void polyblamp_triangle (float* out, const float* phase, const float* inc,
+                         const float* arg, size_t n)
+{
+    for (size_t i=0; i<n; ++i) {
+        float x   = phase[i];
+        float dt  = getDelta(inc[i]);
+        float rdt = 1.0f / dt;
+
+        // Keep both slopes finite
+        float d = arg[i];
+        d = (d < 1e-3f) ? 1e-3f : d;
+        d = (d > 1.0f - 1e-3f) ? 1.0f - 1e-3f : d;
+
+        float rise = 2.0f / d;
+        float fall = 2.0f / (1.0f - d);
+
+        float y = (x < d) ? (-1.0f + rise * x) : (+1.0f - fall * (x - d));
+
+        // Slope changes by (rise + fall) per cycle at 0 and by the opposite
+        // at the duty. The residual is for a change of 2 per sample.
+        float k = 0.5f * (rise + fall) * dt;
+        y += k * polyBlamp(x, dt, rdt);
+        y -= k * polyBlamp(wrap(x - d), dt, rdt);
+
+        out[i] = y;
+    }
+}
+
 }; // Waveform
 
 // ============================================================================
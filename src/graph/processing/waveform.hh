@@ -33,6 +33,24 @@ float triangle      (float x, float arg);
 /// Sawtooth wave
 float sawtooth      (float x, float arg);
 
+// ............................................................................
+
+/// Block waveform function type. Renders n samples given per-sample phase
+/// [0-1), phase increment [cycles per sample] and argument (eg. duty). The
+/// output may point to the same buffer as the increment.
+typedef void (*BlockFunction)(float* out, const float* phase, const float* inc,
+                              const float* arg, size_t n);
+
+/// Square wave with variable duty cycle, PolyBLEP anti-aliased
+void polyblep_square    (float* out, const float* phase, const float* inc,
+                         const float* arg, size_t n);
+/// Sawtooth wave, PolyBLEP anti-aliased
+void polyblep_sawtooth  (float* out, const float* phase, const float* inc,
+                         const float* arg, size_t n);
+/// Triangle wave with variable rise / fall time, PolyBLAMP anti-aliased
+void polyblamp_triangle (float* out, const float* phase, const float* inc,
+                         const float* arg, size_t n);
+
 }; // Waveform
 
 // ============================================================================
@@ -0,0 +1,204 @@
+#include "wavetable.hh"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <complex>
+#include <utility>
+
+#include <cmath>
+#include <cassert>
+
+namespace Graph {
+namespace Processing {
+
+// ============================================================================
+
+#define _2PI 6.283185307179586
+
+namespace {
+
+/// Oversampling factor of the naive waveform used for the spectrum analysis
+constexpr size_t ANALYSIS_OVERSAMPLING = 8;
+
+/// In-place iterative radix-2 FFT. When a_Inverse is set computes the inverse
+/// transform without the 1/N scaling.
+void fft (std::vector<std::complex<double>>& a_Data, bool a_Inverse) {
+    const size_t n = a_Data.size();
+
+    // Bit reversal permutation
+    for (size_t i=1, j=0; i<n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+
+        if (i < j) {
+            std::swap(a_Data[i], a_Data[j]);
+        }
+    }
+
+    // Butterflies
+    for (size_t len=2; len<=n; len <<= 1) {
+        double ang = _2PI / (double)len * (a_Inverse ? +1.0 : -1.0);
+        std::complex<double> wlen (cos(ang), sin(ang));
+
+        for (size_t i=0; i<n; i+=len) {
+            std::complex<double> w (1.0, 0.0);
+            for (size_t j=0; j<len/2; ++j) {
+                auto u = a_Data[i + j];
+                auto v = a_Data[i + j + len/2] * w;
+                a_Data[i + j]         = u + v;
+                a_Data[i + j + len/2] = u - v;
+                w *= wlen;
+            }
+        }
+    }
+}
+
+}; // Anonymous
+
+// ============================================================================
+
+std::shared_ptr<const Wavetable> Wavetable::get (Function a_Function,
+                                                 float a_Arg)
+{
+    typedef std::pair<Function, float> Key;
+
+    static std::mutex mutex;
+    static std::map<Key, std::shared_ptr<const Wavetable>> cache;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Already built
+    Key key (a_Function, a_Arg);
+    auto itr = cache.find(key);
+    if (itr != cache.end()) {
+        return itr->second;
+    }
+
+    // Build
+    std::shared_ptr<const Wavetable> table (new Wavetable(a_Function, a_Arg));
+    cache[key] = table;
+
+    return table;
+}
+
+// ============================================================================
+
+Wavetable::Wavetable (Function a_Function, float a_Arg) {
+
+    const size_t stride = SIZE + 2;
+    const size_t count  = SIZE * ANALYSIS_OVERSAMPLING;
+
+    // Sample the naive waveform with oversampling to keep the aliased part of
+    // its spectrum small.
+    std::vector<std::complex<double>> spectrum (count);
+    for (size_t i=0; i<count; ++i) {
+        float x = (float)i / (float)count;
+        spectrum[i] = a_Function(x, a_Arg);
+    }
+
+    fft(spectrum, false);
+
+    // Build levels
+    m_Data.resize(LEVELS * stride);
+    std::vector<std::complex<double>> level (SIZE);
+
+    for (size_t l=0; l<LEVELS; ++l) {
+        size_t harmonics = (SIZE / 2) >> l;
+
+        // Truncate the spectrum, keep it hermitian so the result is real.
+        // Scale so that the inverse FFT yields the original amplitude.
+        const double scale = 1.0 / (double)count;
+
+        std::fill(level.begin(), level.end(), std::complex<double>(0.0, 0.0));
+        level[0] = spectrum[0] * scale;
+
+        for (size_t k=1; k<=harmonics && k<SIZE/2; ++k) {
+            level[k]        = spectrum[k] * scale;
+            level[SIZE - k] = std::conj(level[k]);
+        }
+
+        // The Nyquist bin is real
+        if (harmonics == SIZE / 2) {
+            level[SIZE / 2] = std::real(spectrum[SIZE / 2]) * scale;
+        }
+
+        fft(level, true);
+
+        // Store
+        float* ptr = m_Data.data() + l * stride;
+        for (size_t i=0; i<SIZE; ++i) {
+            ptr[i] = (float)std::real(level[i]);
+        }
+
+        ptr[SIZE]     = ptr[0];
+        ptr[SIZE + 1] = ptr[1];
+    }
+}
+
+// ============================================================================
+
+size_t Wavetable::getLevel (float a_MaxPhaseIncrement) const {
+
+    // Level l holds (SIZE/2) >> l harmonics so it is alias-free for phase
+    // increments up to 2^l / SIZE.
+    float x = fabsf(a_MaxPhaseIncrement) * (float)SIZE;
+    if (x <= 1.0f) {
+        return 0;
+    }
+
+    int level = (int)ceilf(log2f(x));
+    if (level >= (int)LEVELS) {
+        return LEVELS - 1;
+    }
+
+    return (size_t)level;
+}
+
+const float* Wavetable::getData (size_t a_Level) const {
+    return m_Data.data() + a_Level * (SIZE + 2);
+}
+
+// ============================================================================
+
+void Wavetable::render (size_t a_Level, const float* a_Phase,
+                        const float* a_Gain, float* a_Output,
+                        size_t a_Count) const
+{
+    const float* table = getData(a_Level);
+
+    for (size_t i=0; i<a_Count; ++i) {
+        float   x = a_Phase[i] * (float)SIZE;
+        int32_t j = (int32_t)x;
+        assert(j >= 0 && j <= (int32_t)SIZE);
+        float   w = x - (float)j;
+
+        float y = table[j] + w * (table[j + 1] - table[j]);
+        a_Output[i] = a_Gain[i] * y;
+    }
+}
+
+void Wavetable::render (size_t a_Level, const float* a_Phase,
+                        float a_Gain, float* a_Output,
+                        size_t a_Count) const
+{
+    const float* table = getData(a_Level);
+
+    for (size_t i=0; i<a_Count; ++i) {
+        float   x = a_Phase[i] * (float)SIZE;
+        int32_t j = (int32_t)x;
+        assert(j >= 0 && j <= (int32_t)SIZE);
+        float   w = x - (float)j;
+
+        float y = table[j] + w * (table[j + 1] - table[j]);
+        a_Output[i] = a_Gain * y;
+    }
+}
+
+// ============================================================================
+
+}; // Processing
+}; // Graph
@@ -0,0 +1,66 @@
+#ifndef GRAPH_PROCESSING_WAVETABLE_HH
+#define GRAPH_PROCESSING_WAVETABLE_HH
+
+#include <vector>
+#include <memory>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Graph {
+namespace Processing {
+
+// ============================================================================
+
+/// A mip-mapped, band-limited wavetable holding a single cycle of a waveform.
+/// Level 0 contains all harmonics up to SIZE/2, each next level contains half
+/// of the harmonics of the previous one. Tables are immutable, built once on
+/// first request and shared by all users.
+class Wavetable {
+public:
+
+    /// Waveform function type. Takes phase [0-1) and an argument (eg. duty)
+    typedef float (*Function)(float, float);
+
+    /// Number of samples per cycle
+    static constexpr size_t SIZE   = 2048;
+    /// Number of mip-map levels (octaves)
+    static constexpr size_t LEVELS = 11;
+
+    /// Returns a shared table for the given waveform function and argument
+    static std::shared_ptr<const Wavetable> get (Function a_Function,
+                                                 float a_Arg);
+
+    /// Returns the level suitable for the given maximal phase increment (in
+    /// cycles per sample) so that no harmonic exceeds the Nyquist frequency.
+    size_t getLevel (float a_MaxPhaseIncrement) const;
+
+    /// Renders a block. For each sample looks up the table at the given
+    /// phase [0-1] using linear interpolation and multiplies the result by the
+    /// gain. Gain and output may point to the same buffer. Phases must be
+    /// within the range, they are not clamped.
+    void render (size_t a_Level, const float* a_Phase, const float* a_Gain,
+                 float* a_Output, size_t a_Count) const;
+    /// Renders a block with a constant gain
+    void render (size_t a_Level, const float* a_Phase, float a_Gain,
+                 float* a_Output, size_t a_Count) const;
+
+protected:
+
+    /// Builds the table
+    Wavetable (Function a_Function, float a_Arg);
+
+    /// Returns a pointer to the level data. Each level has SIZE + 2 samples,
+    /// the last two repeat the first ones for wrap-around interpolation.
+    const float* getData (size_t a_Level) const;
+
+    /// Table data for all levels
+    std::vector<float> m_Data;
+};
+
+// ============================================================================
+
+}; // Processing
+}; // Graph
+
+#endif // GRAPH_PROCESSING_WAVETABLE_HH
@@ -9,10 +9,11 @@ namespace Instrument {
 
 // ============================================================================
 
-Instrument* createInstrument (Graph::Builder* a_Builder,
+Instrument* createInstrument (std::shared_ptr<Graph::Builder> a_Builder,
                               const ElementTree::Node* a_Node,
                               size_t a_SampleRate,
-                              size_t a_BufferSize)
+                              size_t a_BufferSize,
+                              VoicePool* a_Pool)
 {
     Instrument::Attributes attributes;
 
@@ -67,7 +68,8 @@ Instrument* createInstrument (Graph::Builder* a_Builder,
         a_Builder,
         a_SampleRate,
         a_BufferSize,
-        attributes
+        attributes,
+        a_Pool
     );
 }
 
@@ -75,7 +77,8 @@ Instrument* createInstrument (Graph::Builder* a_Builder,
 
 Instruments loadInstruments (const std::string& a_Config,
                              size_t a_SampleRate,
-                             size_t a_BufferSize)
+                             size_t a_BufferSize,
+                             VoicePool* a_Pool)
 {
     // Load the config
     auto root = xmlToElementTree(a_Config);
@@ -94,11 +97,11 @@ Instruments loadInstruments (const std::string& a_Config,
         throw BuildError("No 'instruments' section in the config file!");
     }
 
-    // Create graph builder
-    Graph::Builder builder;
+    // Create graph builder. Shared by the instruments for building voices.
+    auto builder = std::make_shared<Graph::Builder>();
 
-    builder.registerBuiltinModules();
-    builder.registerDefinedModules(modules.get());
+    builder->registerBuiltinModules();
+    builder->registerDefinedModules(modules.get());
 
     // Create instruments
     Instruments instrumentObjects;
@@ -106,7 +109,7 @@ Instruments loadInstruments (const std::string& a_Config,
 
         // Create the instrument
         auto instrument = std::shared_ptr<Instrument>(
-            createInstrument(&builder, node.get(), a_SampleRate, a_BufferSize));
+            createInstrument(builder, node.get(), a_SampleRate, a_BufferSize, a_Pool));
 
         // Check the name
         auto name = instrument->getName();
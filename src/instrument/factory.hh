@@ -20,16 +20,20 @@ namespace Instrument {
 typedef Dict<std::string, std::shared_ptr<Instrument>> Instruments;
 
 /// Creates a single instrument given a ready GraphBuilder object and a
-/// description in a form of ElementTree.
-Instrument* createInstrument (Graph::Builder* a_Builder,
+/// description in a form of ElementTree. The instrument keeps the builder to
+/// build its voices later. The voice pool may be nullptr.
+Instrument* createInstrument (std::shared_ptr<Graph::Builder> a_Builder,
                               const ElementTree::Node* a_Node,
                               size_t a_SampleRate,
-                              size_t a_BufferSize);
+                              size_t a_BufferSize,
+                              VoicePool* a_Pool = nullptr);
 
-/// Loads instruments from a configuration file
+/// Loads instruments from a configuration file. All instruments share the
+/// given voice pool which may be nullptr.
 Instruments loadInstruments  (const std::string& a_Config,
                               size_t a_SampleRate,
-                              size_t a_BufferSize);
+                              size_t a_BufferSize,
+                              VoicePool* a_Pool = nullptr);
 
 // ============================================================================
 
@@ -12,6 +12,8 @@
 #include <spdlog/sinks/stdout_color_sinks.h>
 
 #include <algorithm>
+#include <chrono>
+#include <cassert>
 
 namespace Instrument {
 
@@ -19,11 +21,17 @@ namespace Instrument {
 
 Instrument::Instrument (const std::string& a_Name,
                         const std::string& a_Module,
-                        Graph::Builder* a_Builder,
+                        std::shared_ptr<Graph::Builder> a_Builder,
                         size_t a_SampleRate,
                         size_t a_BufferSize,
-                        const Attributes& a_Attributes) :
-    m_Name (a_Name)
+                        const Attributes& a_Attributes,
+                        VoicePool* a_Pool) :
+    m_Name       (a_Name),
+    m_Module     (a_Module),
+    m_Builder    (a_Builder),
+    m_SampleRate (a_SampleRate),
+    m_BufferSize (a_BufferSize),
+    m_Pool       (a_Pool)
 {
     // Create the logger
     std::string loggerName = stringf("instrument [%s]", a_Name.c_str());
@@ -62,29 +70,83 @@ Instrument::Instrument (const std::string& a_Name,
     m_MinSilentTime  = std::stof(a_Attributes.get("minSilentTime", "0.1"));
     m_MaxPlayTime    = std::stof(a_Attributes.get("maxPlayTime",   "60.0"));
 
-    /// Build a top-level module for each voice
-    for (size_t i=0; i<maxVoices; ++i) {
-        const std::string name = stringf("%s#%d", m_Name.c_str(), i);
+    auto policy = a_Attributes.get("voiceStealing", "released");
+    if (policy == "none") {
+        m_StealPolicy = StealPolicy::NONE;
+    } else if (policy == "oldest") {
+        m_StealPolicy = StealPolicy::OLDEST;
+    } else if (policy == "quietest") {
+        m_StealPolicy = StealPolicy::QUIETEST;
+    } else if (policy == "released") {
+        m_StealPolicy = StealPolicy::RELEASED;
+    } else {
+        THROW(BuildError, "Invalid voice stealing policy '%s'",
+            policy.c_str()
+        );
+    }
 
-        // Build the module        
-        auto module = a_Builder->build(a_Module, name);
-        module->prepare(a_SampleRate, a_BufferSize);
+    auto mode = a_Attributes.get("voiceMode", "poly");
+    if (mode == "poly") {
+        m_VoiceMode = VoiceMode::POLY;
+    } else if (mode == "mono") {
+        m_VoiceMode = VoiceMode::MONO;
+    } else if (mode == "legato") {
+        m_VoiceMode = VoiceMode::LEGATO;
+    } else {
+        THROW(BuildError, "Invalid voice mode '%s'", mode.c_str());
+    }
 
-        // DEBUG - dump attributes
-        m_Logger->debug("Attributes:");
-        for (auto it : module->getAttributes()) {
-            m_Logger->debug(" '{}' = '{}'", it.first, it.second);
-        }
+    float fadeTime    = std::stof(a_Attributes.get("stealFadeTime", "0.005"));
+    m_StealFadeLength = (size_t)std::max(fadeTime * (float)a_SampleRate, 1.0f);
+
+    // Build the prototype. Errors in the definition show up here.
+    auto module = m_Builder->build(m_Module, stringf("%s#proto", m_Name.c_str()));
+    module->prepare(a_SampleRate, a_BufferSize);
+
+    // DEBUG - dump attributes
+    m_Logger->debug("Attributes:");
+    for (auto it : module->getAttributes()) {
+        m_Logger->debug(" '{}' = '{}'", it.first, it.second);
+    }
+
+    // DEBUG - dump parameters
+    m_Logger->debug("Parameters:");
+    for (auto it : module->getParameters()) {
+        m_Logger->debug(" '{}'", it.first);
+    }
+
+    m_Prototype.reset(new Voice(module, m_MinLevel, &m_ControllerState));
+    m_VoiceMemory = module->getMemoryUsage();
+
+    // Voice slots are empty until needed. Stack them so that the first slot
+    // is built first.
+    m_Voices.resize(maxVoices);
+    for (size_t i=maxVoices; i-->0; ) {
+        m_EmptySlots.push_back(i);
+    }
 
-        // DEBUG - dump parameters
-        m_Logger->debug("Parameters:");
-        for (auto it : module->getParameters()) {
-            m_Logger->debug(" '{}'", it.first);
+    // Slot lists never grow past the slot count. Reserve them so that the
+    // audio thread does not allocate when moving slots around.
+    m_IdleSlots  .reserve(maxVoices);
+    m_BuildSlots .reserve(maxVoices);
+    m_BuiltVoices.reserve(maxVoices);
+    m_DeadVoices .reserve(maxVoices);
+
+    // Build spare voices now, further ones are built in the background
+    m_SpareVoices = std::stoi(a_Attributes.get("spareVoices", "4"));
+    while (m_IdleSlots.size() < m_SpareVoices && !m_EmptySlots.empty()) {
+        if (m_Pool != nullptr && !m_Pool->acquire(m_VoiceMemory, false)) {
+            break;
         }
 
-        // Create a voice
-        std::shared_ptr<Voice> voice (new Voice(module, m_MinLevel));
-        m_Voices.push_back(voice);
+        size_t slot = m_EmptySlots.back();
+        m_EmptySlots.pop_back();
+
+        buildVoice(slot);
+    }
+
+    if (m_Pool != nullptr) {
+        m_Pool->addInstrument(this);
     }
 
     // Get parameters file name
@@ -92,6 +154,26 @@ Instrument::Instrument (const std::string& a_Name,
         stringf("%s_params.txt", a_Name.c_str()));
 }
 
+Instrument::~Instrument () {
+
+    if (m_Pool != nullptr) {
+
+        // Stop the worker from servicing the instrument
+        m_Pool->removeInstrument(this);
+
+        // Return the budget of all built and requested voices
+        for (auto& voice : m_Voices) {
+            if (voice) {
+                m_Pool->release(m_VoiceMemory);
+            }
+        }
+
+        for (size_t i=0; i<m_PendingVoices; ++i) {
+            m_Pool->release(m_VoiceMemory);
+        }
+    }
+}
+
 // ============================================================================
 
 std::string Instrument::getName () const {
@@ -100,151 +182,399 @@ std::string Instrument::getName () const {
 
 void Instrument::dumpGraphAsDot (const std::string& a_FileName) {
 
-    auto module = m_Voices.at(0)->getModule();
+    auto module = m_Prototype->getModule();
 
     // Dump the graph
     Graph::DotWriter writer(module);
     writer.writeDot(a_FileName);
 }
 
-Voice* Instrument::getFreeVoice () {
+Voice* Instrument::getFreeVoice (size_t* a_Slot) {
+
+    // Build one right away when that is allowed
+    if (m_IdleSlots.empty() && !m_EmptySlots.empty() &&
+        (m_Pool == nullptr || !m_Pool->hasBackgroundBuilds()))
+    {
+        if (m_Pool == nullptr || m_Pool->acquire(m_VoiceMemory)) {
+            size_t slot = m_EmptySlots.back();
+            m_EmptySlots.pop_back();
+
+            buildVoice(slot);
+        }
+    }
 
-    // Find a free voice
-    for (auto& candidate : m_Voices) {
-        if (!candidate->isActive()) {
-            return candidate.get();
+    // Reuse the most recently used idle voice, keep enough spares
+    if (!m_IdleSlots.empty()) {
+        *a_Slot = m_IdleSlots.back();
+        m_IdleSlots.pop_back();
+
+        if (m_Pool != nullptr) {
+            m_Pool->recordHit();
         }
+
+        requestSpares();
+        return m_Voices[*a_Slot].get();
     }
 
-    // No free voice, get the one that has been playing longest
-    // TODO:
+    // Have one built for later notes. This one has to steal.
+    if (m_PendingVoices == 0 && m_Pool != nullptr &&
+        m_Pool->hasBackgroundBuilds())
+    {
+        requestVoice(true);
+    }
+
+    // No free voice, steal one
+    uint8_t note;
+    if (!selectVictim(&note)) {
+        return nullptr;
+    }
+
+    m_Logger->debug("Stealing voice of note {}", note);
 
-    return nullptr;
+    Note victim = m_ActiveVoices.at(note);
+    m_ActiveVoices.erase(note);
+
+    victim.voice->steal(m_StealFadeLength);
+
+    *a_Slot = victim.slot;
+    return victim.voice;
 }
 
-// ============================================================================
+std::shared_ptr<Voice> Instrument::createVoice (size_t a_Slot) {
 
-void Instrument::processEvents (const std::vector<MIDI::Event>& a_Events,
-                                std::vector<Voice*>& a_ActiveVoices)
+    // Build the module
+    const std::string name = stringf("%s#%zu", m_Name.c_str(), a_Slot);
+    auto module = m_Builder->build(m_Module, name);
+    module->prepare(m_SampleRate, m_BufferSize);
+
+    // Create the voice
+    return std::shared_ptr<Voice>(
+        new Voice(module, m_MinLevel, &m_ControllerState)
+    );
+}
+
+void Instrument::copyParameters (Voice* a_Voice) {
+
+    Graph::Module::ParameterValues values;
+    for (auto& it : m_Prototype->getModule()->getParameters()) {
+        if (!it.second.isLocked()) {
+            values.set(it.first, it.second.get());
+        }
+    }
+
+    a_Voice->getModule()->updateParameters(values);
+}
+
+void Instrument::buildVoice (size_t a_Slot) {
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    auto voice = createVoice(a_Slot);
+    copyParameters(voice.get());
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    double time = std::chrono::duration<double>(t1 - t0).count();
+
+    installVoice(a_Slot, voice, time);
+}
+
+void Instrument::installVoice (size_t a_Slot, std::shared_ptr<Voice> a_Voice,
+                               double a_Time)
 {
-    // Process MIDI events, activate new voices
-    for (auto& event : a_Events) {
+    if (m_HasRandomSeed) {
+        a_Voice->setRandomSeed(Utils::mixSeed(m_RandomSeed, a_Slot));
+    }
 
-        // Note on
-        if (event.type == MIDI::Event::Type::NOTE_ON) {
+    m_Voices[a_Slot] = std::move(a_Voice);
+    m_IdleSlots.push_back(a_Slot);
 
-            // Filter channel
-            if (m_MidiChannel != 0) {
-                if (event.data.note.channel != (m_MidiChannel - 1))
-                    continue;
-            }
+    if (m_Pool != nullptr) {
+        m_Pool->recordBuild(a_Time);
+    }
 
-            // Filter note
-            uint8_t note = event.data.note.note;
-            if (note < m_MinNote || note > m_MaxNote) {
-                continue;
-            }
+    m_Logger->debug("Built voice {} in {:.3f}ms", a_Slot, a_Time * 1e3);
+}
 
-            Voice* voice = nullptr;
+bool Instrument::requestVoice (bool a_Reclaim) {
 
-            // Check if we already have an active voice for that note
-            if (m_ActiveVoices.count(note) != 0) {
-                voice = m_ActiveVoices[note];
-            }
-            // We don't. Get a new voice
-            else {
+    if (m_Pool == nullptr || m_EmptySlots.empty()) {
+        return false;
+    }
+    if (!m_Pool->acquire(m_VoiceMemory, a_Reclaim)) {
+        return false;
+    }
+
+    size_t slot = m_EmptySlots.back();
+    m_EmptySlots.pop_back();
 
-                // Find
-                voice = getFreeVoice();
+    {
+        std::lock_guard<std::mutex> lock(m_BuildLock);
+        m_BuildSlots.push_back(slot);
+    }
+
+    m_PendingVoices++;
+    m_Pool->notify();
 
-                // No free voices
-                if (voice == nullptr) {
-                    m_Logger->warn("No free voice for note {}", note);
-                    continue;
-                }
+    return true;
+}
 
-                // Activate the new voice
-                m_Logger->debug("New voice for note {}", note);
-                voice->activate();
+void Instrument::requestSpares () {
 
-                // Store in the active voice map
-                m_ActiveVoices[note] = voice;
-            }
+    if (m_Pool == nullptr || !m_Pool->hasBackgroundBuilds()) {
+        return;
+    }
 
-            // Dispatch the event
-            voice->pushEvent(event);
+    // Do not reclaim voices of others for spares
+    while (m_IdleSlots.size() + m_PendingVoices < m_SpareVoices) {
+        if (!requestVoice(false)) {
+            break;
         }
+    }
+}
 
-        // Note off
-        else if (event.type == MIDI::Event::Type::NOTE_OFF) {
+void Instrument::collectVoices () {
 
-            // Filter channel
-            if (m_MidiChannel != 0) {
-                if (event.data.note.channel != (m_MidiChannel - 1))
-                    continue;
-            }
+    if (m_PendingVoices == 0) {
+        return;
+    }
 
-            // Filter note
-            uint8_t note = event.data.note.note;
-            if (note < m_MinNote || note > m_MaxNote) {
-                continue;
+    // The worker may be handing a voice over, try again next time
+    std::unique_lock<std::mutex> lock(m_BuildLock, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+
+    for (auto& built : m_BuiltVoices) {
+        if (built.voice) {
+            installVoice(built.slot, std::move(built.voice), built.time);
+        }
+        else {
+            m_EmptySlots.push_back(built.slot);
+            m_Pool->release(m_VoiceMemory);
+        }
+
+        m_PendingVoices--;
+    }
+
+    m_BuiltVoices.clear();
+}
+
+void Instrument::serviceVoices () {
+
+    std::vector<size_t> slots;
+    std::vector<std::shared_ptr<Voice>> dead;
+
+    // Take the work
+    {
+        std::lock_guard<std::mutex> lock(m_BuildLock);
+
+        slots.assign(m_BuildSlots.begin(), m_BuildSlots.end());
+        m_BuildSlots.clear();
+
+        for (auto& voice : m_DeadVoices) {
+            dead.push_back(std::move(voice));
+        }
+        m_DeadVoices.clear();
+    }
+
+    // Destroy reclaimed voices
+    dead.clear();
+
+    // Build requested ones. Parameters are copied under the lock so that
+    // updates made meanwhile reach the voice either way.
+    for (size_t slot : slots) {
+        auto t0 = std::chrono::high_resolution_clock::now();
+
+        std::shared_ptr<Voice> voice;
+        try {
+            voice = createVoice(slot);
+        }
+        catch (const std::exception& ex) {
+            m_Logger->error("Error building voice {}: {}", slot, ex.what());
+        }
+
+        auto t1 = std::chrono::high_resolution_clock::now();
+        double time = std::chrono::duration<double>(t1 - t0).count();
+
+        std::lock_guard<std::mutex> lock(m_BuildLock);
+        if (voice) {
+            copyParameters(voice.get());
+        }
+
+        // A failed build is handed over too, without a voice, so that its
+        // slot and budget are returned.
+        BuiltVoice built;
+        built.slot  = slot;
+        built.voice = voice;
+        built.time  = time;
+        m_BuiltVoices.push_back(built);
+    }
+}
+
+bool Instrument::selectVictim (uint8_t* a_Note) {
+
+    if (m_StealPolicy == StealPolicy::NONE) {
+        return false;
+    }
+
+    // Voices already being stolen have their new notes queued, take them
+    // only when there is nothing else. Otherwise the one that is better by
+    // the policy wins, ties go to the older note.
+    const Note* best = nullptr;
+    for (auto& itr : m_ActiveVoices) {
+        const Note& note = itr.second;
+
+        bool better = (best == nullptr);
+        if (!better && note.voice->isStolen() != best->voice->isStolen()) {
+            better = best->voice->isStolen();
+        }
+        else if (!better && note.voice->isStolen()) {
+            better = (note.order < best->order);
+        }
+        else if (!better) {
+            switch (m_StealPolicy)
+            {
+            case StealPolicy::QUIETEST: {
+                float a = note.voice->getPeakLevel();
+                float b = best->voice->getPeakLevel();
+                better  = (a < b) || (a == b && note.order < best->order);
+                break;
+            }
+            case StealPolicy::RELEASED:
+                better = (note.released != best->released) ?
+                    note.released : (note.order < best->order);
+                break;
+            default:
+                better = (note.order < best->order);
+                break;
             }
+        }
+
+        if (better) {
+            best    = &note;
+            *a_Note = itr.first;
+        }
+    }
+
+    return best != nullptr;
+}
+
+void Instrument::releaseVoice (size_t a_Slot) {
+    m_Voices[a_Slot]->deactivate();
+    m_IdleSlots.push_back(a_Slot);
+}
+
+size_t Instrument::getIdleVoiceCount () const {
+    return m_IdleSlots.size();
+}
+
+void Instrument::reclaimIdleVoice () {
+    assert(!m_IdleSlots.empty());
+
+    // Take the least recently used one
+    size_t slot = m_IdleSlots.front();
+    m_IdleSlots.erase(m_IdleSlots.begin());
+
+    // Have the worker destroy it
+    {
+        std::lock_guard<std::mutex> lock(m_BuildLock);
+        m_DeadVoices.push_back(std::move(m_Voices[slot]));
+    }
+
+    m_EmptySlots.push_back(slot);
+
+    if (m_Pool != nullptr) {
+        m_Pool->release(m_VoiceMemory);
+        m_Pool->notify();
+    }
+
+    m_Logger->debug("Reclaimed voice {}", slot);
+}
+
+bool Instrument::acceptsChannel (uint8_t a_Channel) const {
+    return m_MidiChannel == 0 || a_Channel == (m_MidiChannel - 1);
+}
+
+bool Instrument::acceptsNote (uint8_t a_Channel, uint8_t a_Note) const {
+    return acceptsChannel(a_Channel) && a_Note >= m_MinNote && a_Note <= m_MaxNote;
+}
+
+void Instrument::setRandomSeed (uint32_t a_Seed) {
+    m_HasRandomSeed = true;
+    m_RandomSeed    = a_Seed;
+
+    for (size_t i=0; i<m_Voices.size(); ++i) {
+        if (m_Voices[i]) {
+            m_Voices[i]->setRandomSeed(Utils::mixSeed(a_Seed, i));
+        }
+    }
+}
+
+// ============================================================================
+
+void Instrument::processEvents (const std::vector<MIDI::Event>& a_Events,
+                                std::vector<Voice*>& a_ActiveVoices)
+{
+    // Pick up voices built in the background
+    collectVoices();
+
+    // Controller changes are collected per buffer
+    m_ControllerState.beginBuffer();
+
+    // Process MIDI events, activate new voices
+    for (auto& event : a_Events) {
 
-            // We do not have that note active
-            if (m_ActiveVoices.count(note) == 0) {
-                m_Logger->warn("Note {} was not playing", note);
+        // Note on / off
+        if (event.type == MIDI::Event::Type::NOTE_ON ||
+            event.type == MIDI::Event::Type::NOTE_OFF)
+        {
+            // Filter channel and note
+            if (!acceptsNote(event.data.note.channel, event.data.note.note)) {
                 continue;
             }
 
-            // Dispatch the event
-            Voice* voice = m_ActiveVoices[note];
-            voice->pushEvent(event);
+            bool on = (event.type == MIDI::Event::Type::NOTE_ON);
+            if (m_VoiceMode == VoiceMode::POLY) {
+                if (on) noteOn(event); else noteOff(event);
+            } else {
+                if (on) monoNoteOn(event); else monoNoteOff(event);
+            }
         }
 
         // Controller
         else if (event.type == MIDI::Event::Type::CONTROLLER) {
 
             // Filter channel
-            if (m_MidiChannel != 0) {
-                if (event.data.ctrl.channel != (m_MidiChannel - 1))
-                    continue;
-            }
-
-            // All sounds off
-            if (event.data.ctrl.param == 120 || event.data.ctrl.param == 123) {
-
-                // Deactivate all immediately
-                for (auto itr : m_ActiveVoices) {
-                    Voice* voice = itr.second;
-                    voice->deactivate();
-                }
-
-                m_Logger->debug("All voices off");
-                m_ActiveVoices.clear();
+            if (!acceptsChannel(event.data.ctrl.channel)) {
+                continue;
             }
-            // Dispatch to all voices
-            else {
 
-                for (auto voice : m_Voices) {
-                    voice->pushEvent(event);
-                }
-            }
+            controller(event);
         }
     }
 
-    // Deactivate voices
-    int64_t minTime = (int64_t)(m_MinSilentTime * 1e3f);
-    int64_t maxTime = (int64_t)(m_MaxPlayTime   * 1e3f);
+    // Deactivate voices. Their times are in samples.
+    int64_t minTime = (int64_t)(m_MinSilentTime * (float)m_SampleRate);
+    int64_t maxTime = (int64_t)(m_MaxPlayTime   * (float)m_SampleRate);
 
     for (auto itr = m_ActiveVoices.begin(); itr != m_ActiveVoices.end(); ) {
         auto note  = itr->first;
-        auto voice = itr->second;
+        auto voice = itr->second.voice;
+        auto slot  = itr->second.slot;
 
-        // Deactivate the voice if silent for too long
-        if (voice->getSilentTime() > minTime || voice->getActiveTime() > maxTime) {
+        // A stolen voice restarts for its new note, do not deactivate it
+        if (voice->isStolen()) {
+            itr++;
+            continue;
+        }
+
+        // Deactivate the voice once provably silent, or if silent for too
+        // long when that cannot be told
+        if (voice->isSilent() || voice->getSilentTime() > minTime ||
+            voice->getActiveTime() > maxTime)
+        {
             m_Logger->debug("Deactivating note {}", note);
 
-            voice->deactivate();
+            releaseVoice(slot);
 
             itr = m_ActiveVoices.erase(itr);
             continue;
@@ -254,26 +584,278 @@ void Instrument::processEvents (const std::vector<MIDI::Event>& a_Events,
         itr++;
     }
 
-    // Fill in the vector of active voices
-    for (auto& it : m_ActiveVoices) {
-        a_ActiveVoices.push_back(it.second);
+    // Fill in the vector of active voices. Keep the voice slot order so that
+    // it does not depend on the note map layout.
+    for (auto& voice : m_Voices) {
+        if (voice && voice->isActive()) {
+            a_ActiveVoices.push_back(voice.get());
+        }
     }
 }
 
 // ============================================================================
 
+void Instrument::noteOn (const MIDI::Event& a_Event) {
+    uint8_t note = a_Event.data.note.note;
+
+    // Check if we already have an active voice for that note
+    auto itr = m_ActiveVoices.find(note);
+    if (itr != m_ActiveVoices.end()) {
+        Note& active = itr->second;
+
+        // The gate is still up while the key is down or a pedal holds the
+        // note, retrigger it.
+        if (!active.released) {
+            retrigger(active.voice, note, a_Event);
+        } else {
+            active.voice->pushEvent(a_Event);
+        }
+
+        active.order      = m_NoteCounter++;
+        active.keyDown    = true;
+        active.released   = false;
+        active.pendingOff = false;
+        return;
+    }
+
+    // We don't. Get a new voice
+    size_t slot;
+    Voice* voice = getFreeVoice(&slot);
+
+    // No free voices
+    if (voice == nullptr) {
+        m_Logger->warn("No free voice for note {}", note);
+        return;
+    }
+
+    // Activate the new voice
+    m_Logger->debug("New voice for note {}", note);
+    voice->activate();
+
+    // Store in the active voice map
+    Note active;
+    active.voice = voice;
+    active.slot  = slot;
+    active.order = m_NoteCounter++;
+
+    m_ActiveVoices[note] = active;
+
+    // Dispatch the event
+    voice->pushEvent(a_Event);
+}
+
+void Instrument::noteOff (const MIDI::Event& a_Event) {
+    uint8_t note = a_Event.data.note.note;
+
+    // We do not have that note active. Normal for notes whose voices were
+    // stolen.
+    auto itr = m_ActiveVoices.find(note);
+    if (itr == m_ActiveVoices.end()) {
+        m_Logger->debug("Note {} was not playing", note);
+        return;
+    }
+
+    Note& active = itr->second;
+    active.keyDown = false;
+
+    // Held by a pedal, release it later
+    if (m_Sustain || active.sostenuto) {
+        active.pendingOff = true;
+        active.offEvent   = a_Event;
+        return;
+    }
+
+    // Dispatch the event
+    active.released = true;
+    active.voice->pushEvent(a_Event);
+}
+
+void Instrument::releasePending (int64_t a_Time) {
+
+    for (auto& itr : m_ActiveVoices) {
+        Note& active = itr.second;
+
+        // Still held
+        if (!active.pendingOff || m_Sustain || active.sostenuto) {
+            continue;
+        }
+
+        // Dispatch the deferred note off at the pedal release time
+        MIDI::Event event = active.offEvent;
+        event.time = a_Time;
+
+        active.pendingOff = false;
+        active.released   = true;
+        active.voice->pushEvent(event);
+    }
+}
+
+// ============================================================================
+
+void Instrument::monoNoteOn (const MIDI::Event& a_Event) {
+    uint8_t note = a_Event.data.note.note;
+
+    // Put the key on top of the stack
+    m_HeldNotes.erase(std::remove(m_HeldNotes.begin(), m_HeldNotes.end(), note),
+        m_HeldNotes.end());
+    m_HeldNotes.push_back(note);
+
+    m_MonoVelocity = a_Event.data.note.velocity[0];
+
+    // Nothing sounds, start a voice as usual
+    if (m_ActiveVoices.empty()) {
+        noteOn(a_Event);
+        return;
+    }
+
+    switchNote(a_Event);
+}
+
+void Instrument::monoNoteOff (const MIDI::Event& a_Event) {
+    uint8_t note = a_Event.data.note.note;
+
+    // Remove the key from the stack
+    m_HeldNotes.erase(std::remove(m_HeldNotes.begin(), m_HeldNotes.end(), note),
+        m_HeldNotes.end());
+
+    // Not the sounding note
+    if (m_ActiveVoices.count(note) == 0) {
+        return;
+    }
+
+    // Last key released
+    if (m_HeldNotes.empty()) {
+        noteOff(a_Event);
+        return;
+    }
+
+    // Return to the most recent key still held
+    MIDI::Event event = a_Event;
+    event.type = MIDI::Event::Type::NOTE_ON;
+    event.data.note.note        = m_HeldNotes.back();
+    event.data.note.velocity[0] = m_MonoVelocity;
+    event.data.note.velocity[1] = m_MonoVelocity;
+
+    switchNote(event);
+}
+
+void Instrument::switchNote (const MIDI::Event& a_Event) {
+    uint8_t note = a_Event.data.note.note;
+
+    // Move the sounding voice to the new note
+    auto  itr    = m_ActiveVoices.begin();
+    auto  prev   = itr->first;
+    Note  active = itr->second;
+    m_ActiveVoices.erase(itr);
+
+    active.order      = m_NoteCounter++;
+    active.keyDown    = true;
+    active.released   = false;
+    active.pendingOff = false;
+
+    m_ActiveVoices[note] = active;
+
+    // Legato, only the pitch changes
+    if (m_VoiceMode == VoiceMode::LEGATO) {
+        active.voice->pushEvent(a_Event);
+        return;
+    }
+
+    // Mono, retrigger
+    retrigger(active.voice, prev, a_Event);
+}
+
+void Instrument::retrigger (Voice* a_Voice, uint8_t a_Prev,
+                            const MIDI::Event& a_Event)
+{
+    // Drop the gate for one sample before the new note
+    MIDI::Event off = a_Event;
+    MIDI::Event on  = a_Event;
+    off.type = MIDI::Event::Type::NOTE_OFF;
+    off.data.note.note = a_Prev;
+
+    if ((size_t)on.time + 1 < m_BufferSize) {
+        on.time  += 1;
+    } else {
+        off.time -= 1;
+    }
+
+    a_Voice->pushEvent(off);
+    a_Voice->pushEvent(on);
+}
+
+// ============================================================================
+
+void Instrument::controller (const MIDI::Event& a_Event) {
+    uint32_t param = a_Event.data.ctrl.param;
+    bool     down  = a_Event.data.ctrl.value >= 64;
+
+    // All sounds off
+    if (param == 120 || param == 123) {
+
+        // Deactivate all immediately
+        for (auto itr : m_ActiveVoices) {
+            releaseVoice(itr.second.slot);
+        }
+
+        m_Logger->debug("All voices off");
+        m_ActiveVoices.clear();
+        m_HeldNotes.clear();
+        return;
+    }
+
+    // Sustain pedal. Holds all notes released while it is down.
+    if (param == 64 && down != m_Sustain) {
+        m_Sustain = down;
+        if (!down) {
+            releasePending(a_Event.time);
+        }
+    }
+
+    // Sostenuto pedal. Holds notes whose keys are down when it is pressed.
+    if (param == 66 && down != m_Sostenuto) {
+        m_Sostenuto = down;
+
+        for (auto& itr : m_ActiveVoices) {
+            itr.second.sostenuto = down && itr.second.keyDown;
+        }
+
+        if (!down) {
+            releasePending(a_Event.time);
+        }
+    }
+
+    // Update the shared state. Active voices read the change list.
+    m_ControllerState.update(a_Event);
+}
+
+// ============================================================================
+
 const Graph::Module::Parameters Instrument::getParameters () {
 
-    // All voices have identical pipelines, their parameters are also identical
-    Voice* voice = m_Voices[0].get();
-    return voice->getModule()->getParameters();
+    // All voices are clones of the prototype, their parameters are identical
+    return m_Prototype->getModule()->getParameters();
 }
 
 void Instrument::updateParameters (const Graph::Module::ParameterValues& a_Values) {
 
-    // Update parameters in all modules
+    // Update parameters in the prototype and voices waiting to be installed
+    {
+        std::lock_guard<std::mutex> lock(m_BuildLock);
+
+        m_Prototype->getModule()->updateParameters(a_Values);
+        for (auto& built : m_BuiltVoices) {
+            if (built.voice) {
+                built.voice->getModule()->updateParameters(a_Values);
+            }
+        }
+    }
+
+    // And in all built voices
     for (auto& voice : m_Voices) {
-        voice->getModule()->updateParameters(a_Values);
+        if (voice) {
+            voice->getModule()->updateParameters(a_Values);
+        }
     }
 }
 
@@ -2,6 +2,7 @@
 #define INSTRUMENT_HH
 
 #include "voice.hh"
+#include "voice_pool.hh"
 
 #include <graph/parameter.hh>
 #include <graph/builder.hh>
@@ -14,6 +15,7 @@
 #include <vector>
 #include <unordered_map>
 #include <memory>
+#include <mutex>
 
 namespace Instrument {
 
@@ -26,13 +28,35 @@ public:
     /// Instrument attributes
     typedef Dict<std::string, std::string> Attributes;
 
-    /// Constructor
+    /// Voice modes
+    enum class VoiceMode {
+        POLY,       /// A voice per note
+        MONO,       /// A single voice, retriggered by each note
+        LEGATO,     /// A single voice, notes played legato only change pitch
+    };
+
+    /// Voice stealing policies, used when there is no free voice for a note
+    enum class StealPolicy {
+        NONE,       /// Do not steal, drop the note
+        OLDEST,     /// Steal the voice playing for the longest time
+        QUIETEST,   /// Steal the voice with the lowest peak level
+        RELEASED,   /// Steal the oldest released voice, the oldest otherwise
+    };
+
+    /// Constructor. Builds the prototype voice and a few spare voices,
+    /// other voices are cloned from it on demand within the budget of the
+    /// given pool, on its worker thread. The pool may be nullptr in which
+    /// case only "maxVoices" applies and voices are built synchronously.
     Instrument (const std::string& a_Name,
                 const std::string& a_Module,
-                Graph::Builder* a_Builder,
+                std::shared_ptr<Graph::Builder> a_Builder,
                 size_t a_SampleRate,
                 size_t a_BufferSize,
-                const Attributes& a_Attributes = Attributes());
+                const Attributes& a_Attributes = Attributes(),
+                VoicePool* a_Pool = nullptr);
+
+    /// Destructor
+    ~Instrument ();
 
     /// Returns the instrument name
     std::string getName () const;
@@ -40,10 +64,31 @@ public:
     /// Dumps graph structure of the first voice to a Graphviz DOT file
     void dumpGraphAsDot (const std::string& a_FileName);
 
-    /// Processed MIDI events. Fills the given vector with active voices
+    /// Returns true when the instrument reacts to events on the given MIDI
+    /// channel (0-15)
+    bool acceptsChannel (uint8_t a_Channel) const;
+    /// Returns true when the instrument reacts to the given note on the
+    /// given MIDI channel
+    bool acceptsNote    (uint8_t a_Channel, uint8_t a_Note) const;
+
+    /// Enables reproducible seeding of all voices. Each voice gets a seed
+    /// derived from the given one and its slot index.
+    void setRandomSeed (uint32_t a_Seed);
+
+    /// Processed MIDI events. Fills the given vector with active voices in
+    /// the voice slot order.
     void processEvents (const std::vector<MIDI::Event>& a_Events,
                         std::vector<Voice*>& a_ActiveVoices);
 
+    /// Returns the count of built voices that are not active
+    size_t getIdleVoiceCount () const;
+    /// Hands the least recently used idle voice over to the pool worker
+    /// for destruction
+    void   reclaimIdleVoice  ();
+    /// Builds requested voices and destroys reclaimed ones. Called by the
+    /// pool worker thread.
+    void   serviceVoices     ();
+
     /// Returns parameters
     const Graph::Module::Parameters getParameters ();
     /// Updates parameters
@@ -56,14 +101,70 @@ public:
 
 protected:
 
-    /// Returns a free voice or nullptr if none
-    Voice* getFreeVoice ();
+    /// Returns a free voice and its slot. Reuses an idle voice or steals
+    /// one according to the policy. A new voice is requested from the pool
+    /// worker when there is no idle one, it only serves later notes. Without
+    /// background builds the voice is built right away instead of stealing.
+    /// Returns nullptr if no voice can be had.
+    Voice* getFreeVoice (size_t* a_Slot);
+    /// Clones the prototype into a new voice for the given slot. Parameter
+    /// values are not copied.
+    std::shared_ptr<Voice> createVoice (size_t a_Slot);
+    /// Copies current parameter values of the prototype to a voice
+    void   copyParameters (Voice* a_Voice);
+    /// Builds a voice synchronously and puts it on the idle list
+    void   buildVoice     (size_t a_Slot);
+    /// Stores a built voice in its slot and puts it on the idle list
+    void   installVoice   (size_t a_Slot, std::shared_ptr<Voice> a_Voice,
+                           double a_Time);
+    /// Asks the pool worker to build a voice in an empty slot. Returns false
+    /// when there is no slot or budget.
+    bool   requestVoice   (bool a_Reclaim);
+    /// Requests voices until there are enough spare ones
+    void   requestSpares  ();
+    /// Installs voices finished by the pool worker. Does not block.
+    void   collectVoices  ();
+    /// Selects an active voice to be stolen, returns the note it plays
+    bool   selectVictim (uint8_t* a_Note);
+    /// Deactivates a voice and returns it to the idle list
+    void   releaseVoice (size_t a_Slot);
+
+    /// Handles a note on event in the polyphonic mode
+    void noteOn         (const MIDI::Event& a_Event);
+    /// Handles a note off event in the polyphonic mode. Defers it when the
+    /// note is held by a pedal.
+    void noteOff        (const MIDI::Event& a_Event);
+    /// Dispatches deferred note offs of notes no longer held by a pedal
+    void releasePending (int64_t a_Time);
+
+    /// Handles a note on event in the mono and legato modes
+    void monoNoteOn     (const MIDI::Event& a_Event);
+    /// Handles a note off event in the mono and legato modes
+    void monoNoteOff    (const MIDI::Event& a_Event);
+    /// Moves the sounding voice to the note of the given note on event
+    void switchNote     (const MIDI::Event& a_Event);
+    /// Pushes a note on to a voice whose gate is up. The gate of the
+    /// previous note is dropped for one sample before it so that envelopes
+    /// see a new edge.
+    void retrigger      (Voice* a_Voice, uint8_t a_Prev,
+                         const MIDI::Event& a_Event);
+
+    /// Handles a controller event
+    void controller     (const MIDI::Event& a_Event);
 
     /// Logger
     std::shared_ptr<spdlog::logger> m_Logger;
 
     /// Name
     const std::string m_Name;
+    /// Top-level module type
+    const std::string m_Module;
+    /// Graph builder used to clone voices
+    std::shared_ptr<Graph::Builder> m_Builder;
+    /// Sample rate
+    size_t m_SampleRate;
+    /// Buffer size
+    size_t m_BufferSize;
     /// MIDI channel. When 0 means all channels
     size_t m_MidiChannel;
     /// Minimum MIDI note index
@@ -78,10 +179,83 @@ protected:
     /// Max voice play time [s]
     float m_MaxPlayTime = 10.0f;
 
-    /// Voice list
+    /// Voice stealing policy
+    StealPolicy m_StealPolicy = StealPolicy::RELEASED;
+    /// Fade-out length of stolen voices [samples]
+    size_t      m_StealFadeLength = 0;
+
+    /// Voice mode
+    VoiceMode m_VoiceMode = VoiceMode::POLY;
+
+    /// A note being played
+    struct Note {
+        Voice*      voice      = nullptr;   /// The voice
+        size_t      slot       = 0;         /// Voice slot index
+        uint64_t    order      = 0;         /// Note-on sequence number
+        bool        keyDown    = true;      /// The key is held
+        bool        released   = false;     /// Note-off sent to the voice
+        bool        sostenuto  = false;     /// Held by the sostenuto pedal
+        bool        pendingOff = false;     /// Note-off deferred by a pedal
+        MIDI::Event offEvent;               /// The deferred note-off
+    };
+
+    /// Sustain pedal state
+    bool m_Sustain   = false;
+    /// Sostenuto pedal state
+    bool m_Sostenuto = false;
+
+    /// Keys held in the mono and legato modes, the most recent last
+    std::vector<uint8_t> m_HeldNotes;
+    /// Velocity of the last note in the mono and legato modes
+    uint8_t m_MonoVelocity = 0;
+
+    /// MIDI controller values shared by all voices. Must outlive them.
+    MIDI::ControllerState m_ControllerState;
+
+    /// Voice pool or nullptr
+    VoicePool* m_Pool;
+    /// Prototype voice. Never plays, holds the current parameter values and
+    /// gets cloned to build new voices.
+    std::shared_ptr<Voice> m_Prototype;
+    /// Estimated memory of a voice [B]
+    size_t m_VoiceMemory = 0;
+
+    /// Voice slots, nullptr when not built
     std::vector<std::shared_ptr<Voice>> m_Voices;
+    /// Slots of built idle voices, most recently used at the back
+    std::vector<size_t> m_IdleSlots;
+    /// Slots without a voice, the one to build next at the back
+    std::vector<size_t> m_EmptySlots;
+    /// Count of idle voices kept built ahead of demand
+    size_t m_SpareVoices = 4;
+
+    /// A voice built by the pool worker
+    struct BuiltVoice {
+        size_t                 slot;    /// Voice slot index
+        std::shared_ptr<Voice> voice;   /// The voice, nullptr if failed
+        double                 time;    /// Build time [s]
+    };
+
+    /// Guards the hand-off of voices to and from the pool worker. Held only
+    /// to move pointers, never while building or destroying.
+    std::mutex m_BuildLock;
+    /// Slots whose voices the worker is to build
+    std::vector<size_t> m_BuildSlots;
+    /// Voices built by the worker, waiting to be installed
+    std::vector<BuiltVoice> m_BuiltVoices;
+    /// Reclaimed voices the worker is to destroy
+    std::vector<std::shared_ptr<Voice>> m_DeadVoices;
+    /// Count of voices requested but not installed yet
+    size_t m_PendingVoices = 0;
     /// MIDI note to active voice map
-    std::unordered_map<uint8_t, Voice*> m_ActiveVoices;
+    std::unordered_map<uint8_t, Note> m_ActiveVoices;
+    /// Note-on sequence counter
+    uint64_t m_NoteCounter = 0;
+
+    /// Reproducible seeding enabled flag
+    bool     m_HasRandomSeed = false;
+    /// Random seed
+    uint32_t m_RandomSeed    = 0;
 
     /// Parameter storage file name
     std::string m_ParametersFile;
@@ -1,17 +1,22 @@
 #include "voice.hh"
 #include "exception.hh"
 
+#include <utils/utils.hh>
 #include <utils/exception.hh>
 #include <stringf.hh>
 
+#include <algorithm>
 #include <cmath>
+#include <cassert>
 
 namespace Instrument {
 
 // ============================================================================
 
-Voice::Voice (const Graph::Module* a_Module, float a_MinLevel) :
-    m_MinLevel (a_MinLevel)
+Voice::Voice (const Graph::Module* a_Module, float a_MinLevel,
+              const MIDI::ControllerState* a_Controllers) :
+    m_MinLevel (a_MinLevel),
+    m_MinPeak  (powf(10.0f, a_MinLevel / 20.0f))
 {
 
     // Store the module
@@ -42,20 +47,26 @@ Voice::Voice (const Graph::Module* a_Module, float a_MinLevel) :
         );
     }
 
-    // Collect MIDI listeners
+    // Collect MIDI listeners, bind controller listeners to the state
     std::function<void(Graph::Module*)> walkAndCollect = [&](Graph::Module* parent) {
         for (auto& it : parent->getSubmodules()) {
             auto& module = it.second;
 
-            // Query interface
+            // Query interfaces
             auto iface = (Graph::Modules::IMidiListener*)module->queryInterface(
                 Graph::Modules::IMidiListener::ID
             );
+            auto ctrl  = (Graph::Modules::IControllerListener*)module->queryInterface(
+                Graph::Modules::IControllerListener::ID
+            );
 
             // Store it
             if (iface != nullptr) {
                 m_MidiListeners.push_back(iface);
             }
+            if (ctrl != nullptr) {
+                ctrl->setControllerState(a_Controllers);
+            }
 
             // Walk recursively
             walkAndCollect(module.get());
@@ -63,9 +74,6 @@ Voice::Voice (const Graph::Module* a_Module, float a_MinLevel) :
     };
 
     walkAndCollect(const_cast<Graph::Module*>(a_Module));
-
-    // Create the output buffer
-    m_Buffer.create(a_Module->getBufferSize(), 2);
 }
 
 Graph::Module* Voice::getModule () {
@@ -89,13 +97,18 @@ void Voice::activate () {
         return;
     }
 
+    if (m_HasRandomSeed) {
+        m_Module->setRandomSeed(Utils::mixSeed(m_RandomSeed, m_Activations++));
+    }
+
     m_Module->start();
 
     m_Active     = true;
     m_Playing    = false;
+    m_Silent     = false;
     m_ActiveTime = 0;
     m_SilentTime = 0;
-    m_PeakLevel  = -std::numeric_limits<float>::infinity(); 
+    m_Peak       = 0.0f;
 
     m_MidiEvents.clear();
 }
@@ -111,6 +124,33 @@ void Voice::deactivate () {
 
     m_Active  = false;
     m_Playing = false;
+    m_Silent  = false;
+    m_Stolen  = false;
+
+    m_HeldEvents.clear();
+}
+
+void Voice::steal (size_t a_FadeLength) {
+    assert(m_Active);
+
+    // Already fading out, only the held events get replaced
+    if (!m_Stolen) {
+        m_Stolen     = true;
+        m_FadeLength = std::max<size_t>(a_FadeLength, 1);
+        m_FadePos    = 0;
+    }
+
+    m_HeldEvents.clear();
+}
+
+bool Voice::isStolen () const {
+    return m_Stolen;
+}
+
+void Voice::setRandomSeed (uint32_t a_Seed) {
+    m_HasRandomSeed = true;
+    m_RandomSeed    = a_Seed;
+    m_Activations   = 0;
 }
 
 // ============================================================================
@@ -123,10 +163,17 @@ int64_t Voice::getSilentTime () const {
     return m_SilentTime;
 }
 
+bool Voice::isSilent () const {
+    return m_Silent;
+}
+
 // ============================================================================
 
 void Voice::pushEvent (const MIDI::Event& a_Event) {
 
+    // Events may end a hold
+    m_Silent = false;
+
     // Not active, pass all controller events immediately
     if (!m_Active) {
         for (auto listener : m_MidiListeners) {
@@ -134,6 +181,11 @@ void Voice::pushEvent (const MIDI::Event& a_Event) {
         }
     }
 
+    // Stolen, hold the event for the restart
+    else if (m_Stolen) {
+        m_HeldEvents.push_back(a_Event);
+    }
+
     // Queue the event
     else {
         m_MidiEvents.push_back(a_Event);
@@ -142,7 +194,24 @@ void Voice::pushEvent (const MIDI::Event& a_Event) {
 
 // ============================================================================
 
-void Voice::process () {
+void Voice::process (Audio::BufferView<float> a_Bus) {
+    assert(a_Bus.getChannels() == 2);
+    assert(a_Bus.getSize() == m_Module->getBufferSize());
+
+    // A stolen voice that has faded out restarts for the new note. Held
+    // events belong to an earlier period, deliver them at its beginning.
+    if (m_Stolen && m_FadePos >= m_FadeLength) {
+        auto events = std::move(m_HeldEvents);
+
+        deactivate();
+        activate();
+
+        for (auto& event : events) {
+            event.time = 0;
+        }
+
+        m_MidiEvents = std::move(events);
+    }
 
     // Dispatch all MIDI events to MIDI listeners
     for (auto& event : m_MidiEvents) {
@@ -167,40 +236,49 @@ void Voice::process () {
         }
     }
 
-    // Assemble the stereo buffer
-    if (isStereo()) {
-        size_t size = m_Buffer.getSize() * sizeof(float);
-        memcpy(m_Buffer.data(0), m_AudioPort[0]->getBuffer().data(), size);
-        memcpy(m_Buffer.data(1), m_AudioPort[1]->getBuffer().data(), size);
-    }
-    else {
-        size_t size = m_Buffer.getSize() * sizeof(float);
-        memcpy(m_Buffer.data(0), m_AudioPort[0]->getBuffer().data(), size);
-        memcpy(m_Buffer.data(1), m_AudioPort[0]->getBuffer().data(), size);
+    // Samples past the point where the outputs provably fall silent need
+    // neither mixing nor a peak scan.
+    size_t size  = a_Bus.getSize();
+    size_t start = getSilentStart();
+
+    m_Silent = (start != Graph::Modules::IHoldReporter::NONE);
+    if (m_Silent) {
+        size = std::min(size, start);
     }
 
-    // Compute peak sample value
-    float  peak = 0.0f;
-    size_t size = m_Buffer.getSize() * m_Buffer.getChannels();
-    float* ptr  = m_Buffer.data();
+    // Accumulate port buffers directly into the mix bus, compute the peak
+    // sample value.
+    float peak = 0.0f;
 
-    for (size_t i=0; i<size; ++i) {
-        float mag = fabs(*ptr++);
-        if (mag > peak) peak = mag;
-    }
+    for (size_t c=0; c<2 && size!=0; ++c) {
+        const float* src = m_AudioPort[isStereo() ? c : 0]->getBuffer().data();
 
-    // Convert to dB
-    if (peak == 0.0f) {
-        m_PeakLevel = -std::numeric_limits<float>::infinity();
-    } else {
-        m_PeakLevel = 20.0f * log10f(peak);
+        // Fade out a stolen voice
+        if (m_Stolen) {
+            float* dst  = a_Bus.data(c);
+            float  step = 1.0f / (float)m_FadeLength;
+            float  gain = 1.0f - (float)m_FadePos * step;
+
+            for (size_t j=0; j<size; ++j) {
+                dst[j] += src[j] * std::max(gain, 0.0f);
+                gain   -= step;
+            }
+        }
+        else {
+            Audio::Kernels::add(a_Bus.data(c), src, size);
+        }
+
+        if (c == 0 || isStereo()) {
+            peak = std::max(peak, Audio::Kernels::peak(src, size));
+        }
     }
 
-    // Update times
-    int64_t periodTime = 
-        (1e3f * (float)m_Module->getBufferSize() / m_Module->getSampleRate());
+    m_Peak = peak;
+
+    // Update times. Kept in samples, whole buffers may be shorter than 1 ms.
+    int64_t periodTime = (int64_t)m_Module->getBufferSize();
 
-    if (m_PeakLevel > m_MinLevel) {
+    if (m_Peak > m_MinPeak) {
         m_Playing     = true;
         m_SilentTime  = 0;
     } else {
@@ -210,14 +288,41 @@ void Voice::process () {
     if (m_Playing) {
          m_ActiveTime += periodTime;
     }
+
+    // Advance the fade-out
+    if (m_Stolen) {
+        m_FadePos += a_Bus.getSize();
+    }
 }
 
-const Audio::Buffer<float> Voice::getBuffer () const {
-    return m_Buffer;
+size_t Voice::getSilentStart () {
+    using Graph::Modules::IHoldReporter;
+
+    size_t start = 0;
+
+    for (size_t i=0; i<2; ++i) {
+        if (m_AudioPort[i] == nullptr) {
+            continue;
+        }
+
+        float  value;
+        size_t hold = IHoldReporter::queryHold(m_AudioPort[i], &value);
+        if (hold == IHoldReporter::NONE || value != 0.0f) {
+            return IHoldReporter::NONE;
+        }
+
+        start = std::max(start, hold);
+    }
+
+    return start;
 }
 
 float Voice::getPeakLevel () const {
-    return m_PeakLevel;
+    if (m_Peak == 0.0f) {
+        return -std::numeric_limits<float>::infinity();
+    }
+
+    return 20.0f * log10f(m_Peak);
 }
 
 // ============================================================================
@@ -3,10 +3,13 @@
 
 #include <audio/buffer.hh>
 #include <midi/event.hh>
+#include <midi/controller_state.hh>
 
 #include <graph/module.hh>
 #include <graph/port.hh>
 #include <graph/iface/midi_listener.hh>
+#include <graph/iface/controller_listener.hh>
+#include <graph/iface/hold_reporter.hh>
 
 #include <vector>
 #include <memory>
@@ -20,8 +23,10 @@ class Voice
 {
 public:
 
-    /// Constructor
-    Voice (const Graph::Module* a_Module, float a_MinLevel = -96.0f);
+    /// Constructor. Modules reading MIDI controllers get bound to the given
+    /// controller state which must outlive the voice.
+    Voice (const Graph::Module* a_Module, float a_MinLevel = -96.0f,
+           const MIDI::ControllerState* a_Controllers = nullptr);
 
     /// Returns true when stereo
     bool isStereo   () const;
@@ -33,18 +38,31 @@ public:
     /// Deactivates the voice
     void deactivate ();
 
-    /// Returns activity time in ms
+    /// Steals an active voice for a new note. The current sound is faded out
+    /// linearly over the given number of samples, then the voice restarts.
+    /// Events pushed in the meantime are held and delivered on the restart.
+    /// Stealing a voice again while it fades out discards the held events.
+    void steal      (size_t a_FadeLength);
+    /// Returns true while fading out after being stolen
+    bool isStolen   () const;
+
+    /// Enables reproducible seeding. Each activation seeds the module graph
+    /// with a value derived from the given seed and the activation count.
+    void setRandomSeed (uint32_t a_Seed);
+
+    /// Returns activity time in samples
     int64_t getActiveTime () const;
-    /// Returns silence time in ms
+    /// Returns silence time in samples
     int64_t getSilentTime () const;
+    /// Returns true when the output is provably silent until new events are
+    /// pushed, as reported by the modules producing it
+    bool    isSilent      () const;
 
     /// Pushes a single MIDI event on the queue
     void pushEvent (const MIDI::Event& a_Event);
 
-    /// Processes audio
-    void process ();
-    /// Returns the audio buffer
-    const Audio::Buffer<float> getBuffer () const;
+    /// Processes audio. Accumulates the output into the given stereo mix bus
+    void process (Audio::BufferView<float> a_Bus);
     /// Returns the peak audio level in dB
     float getPeakLevel () const;
 
@@ -53,15 +71,21 @@ public:
 
 protected:
 
+    /// Returns the sample of the last processed buffer from which all audio
+    /// outputs hold zero, NONE when that cannot be told
+    size_t getSilentStart ();
+
     /// The top-level module
     std::shared_ptr<Graph::Module> m_Module;
     /// Output audio port of the top-level module
     Graph::Port* m_AudioPort[2];
-    /// Peak audio level [dB]
-    float m_PeakLevel = -std::numeric_limits<float>::infinity();
+    /// Peak audio sample magnitude
+    float m_Peak = 0.0f;
 
     /// MIDI events
     std::vector<MIDI::Event> m_MidiEvents;
+    /// MIDI events held until a stolen voice restarts
+    std::vector<MIDI::Event> m_HeldEvents;
     /// MIDI listeners
     std::vector<Graph::Modules::IMidiListener*> m_MidiListeners;
 
@@ -69,15 +93,30 @@ protected:
     bool    m_Active  = false;
     /// Playing (making actual sound) flag
     bool    m_Playing = false;
+    /// Provably silent flag
+    bool    m_Silent  = false;
     /// Minimal peak signal level
     float   m_MinLevel;
-    /// Active time
+    /// Minimal peak sample magnitude, m_MinLevel converted
+    float   m_MinPeak;
+    /// Active time [samples]
     int64_t m_ActiveTime = 0;
-    /// Silent time
+    /// Silent time [samples]
     int64_t m_SilentTime = 0;
 
-    /// Audio buffer
-    Audio::Buffer<float> m_Buffer;
+    /// Stolen flag
+    bool    m_Stolen     = false;
+    /// Fade-out length of a stolen voice [samples]
+    size_t  m_FadeLength = 0;
+    /// Fade-out position of a stolen voice [samples]
+    size_t  m_FadePos    = 0;
+
+    /// Reproducible seeding enabled flag
+    bool     m_HasRandomSeed = false;
+    /// Random seed
+    uint32_t m_RandomSeed    = 0;
+    /// Activation count since the seed was set
+    uint32_t m_Activations   = 0;
 };
 
 
@@ -0,0 +1,163 @@
+#include "voice_pool.hh"
+#include "instrument.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cassert>
+
+namespace Instrument {
+
+// ============================================================================
+
+VoicePool::VoicePool (size_t a_MaxVoices, size_t a_MaxMemory) :
+    m_MaxVoices (a_MaxVoices),
+    m_MaxMemory (a_MaxMemory),
+    m_Work      (false)
+{
+    m_Thread = std::thread(&VoicePool::worker, this);
+}
+
+VoicePool::~VoicePool () {
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_Stop = true;
+    }
+
+    m_Wakeup.notify_one();
+    m_Thread.join();
+}
+
+void VoicePool::setLimits (size_t a_MaxVoices, size_t a_MaxMemory) {
+    m_MaxVoices = a_MaxVoices;
+    m_MaxMemory = a_MaxMemory;
+}
+
+void VoicePool::setBackgroundBuilds (bool a_Enable) {
+    m_Background = a_Enable;
+}
+
+bool VoicePool::hasBackgroundBuilds () const {
+    return m_Background;
+}
+
+// ============================================================================
+
+void VoicePool::addInstrument (Instrument* a_Instrument) {
+    std::lock_guard<std::mutex> lock(m_Lock);
+    m_Instruments.push_back(a_Instrument);
+}
+
+void VoicePool::removeInstrument (Instrument* a_Instrument) {
+    std::lock_guard<std::mutex> lock(m_Lock);
+    m_Instruments.erase(
+        std::remove(m_Instruments.begin(), m_Instruments.end(), a_Instrument),
+        m_Instruments.end()
+    );
+}
+
+// ============================================================================
+
+bool VoicePool::fits (size_t a_Memory) const {
+
+    if (m_MaxVoices != 0 && m_Stats.liveVoices + 1 > m_MaxVoices) {
+        return false;
+    }
+    if (m_MaxMemory != 0 && m_Stats.memory + a_Memory > m_MaxMemory) {
+        return false;
+    }
+
+    return true;
+}
+
+bool VoicePool::acquire (size_t a_Memory, bool a_Reclaim) {
+
+    // Reclaim idle voices until the new one fits. Take them from the
+    // instrument that has the most of them.
+    while (!fits(a_Memory)) {
+
+        // Spare voices are optional, not a refusal
+        if (!a_Reclaim) {
+            return false;
+        }
+
+        Instrument* victim = nullptr;
+        size_t      count  = 0;
+
+        for (auto instrument : m_Instruments) {
+            size_t idle = instrument->getIdleVoiceCount();
+            if (idle > count) {
+                victim = instrument;
+                count  = idle;
+            }
+        }
+
+        if (victim == nullptr) {
+            m_Stats.refusals++;
+            return false;
+        }
+
+        victim->reclaimIdleVoice();
+        m_Stats.reclaims++;
+    }
+
+    m_Stats.misses++;
+    m_Stats.liveVoices++;
+    m_Stats.memory += a_Memory;
+    m_Stats.peakVoices = std::max(m_Stats.peakVoices, m_Stats.liveVoices);
+
+    return true;
+}
+
+void VoicePool::release (size_t a_Memory) {
+    assert(m_Stats.liveVoices > 0);
+    assert(m_Stats.memory >= a_Memory);
+
+    m_Stats.liveVoices--;
+    m_Stats.memory -= a_Memory;
+}
+
+// ============================================================================
+
+void VoicePool::recordHit () {
+    m_Stats.hits++;
+}
+
+void VoicePool::recordBuild (double a_Time) {
+    m_Stats.buildTime += a_Time;
+}
+
+const VoicePool::Stats& VoicePool::getStats () const {
+    return m_Stats;
+}
+
+// ============================================================================
+
+void VoicePool::notify () {
+    m_Work = true;
+    m_Wakeup.notify_one();
+}
+
+void VoicePool::worker () {
+    std::unique_lock<std::mutex> lock(m_Lock);
+
+    while (!m_Stop) {
+
+        // A notification may get lost as notify() does not take the lock,
+        // poll now and then to pick the work up anyway.
+        m_Wakeup.wait_for(lock, std::chrono::milliseconds(10), [this]() {
+            return m_Stop || m_Work;
+        });
+
+        if (m_Stop || !m_Work.exchange(false)) {
+            continue;
+        }
+
+        for (auto instrument : m_Instruments) {
+            instrument->serviceVoices();
+        }
+    }
+}
+
+// ============================================================================
+
+}; // Instrument
@@ -0,0 +1,124 @@
+#ifndef INSTRUMENT_VOICE_POOL_HH
+#define INSTRUMENT_VOICE_POOL_HH
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Instrument {
+
+class Instrument;
+
+// ============================================================================
+
+/// A voice budget shared by instruments. Instruments build their voices
+/// lazily and ask the pool for permission before building one. When the
+/// budget is exhausted the pool reclaims an idle voice from an instrument
+/// to make room. The budget is not thread safe and is used from the MIDI
+/// event processing only.
+///
+/// The pool also runs a worker thread that builds and destroys voices on
+/// behalf of instruments so that neither happens on the audio thread.
+/// Instruments only hand finished voices over to it.
+class VoicePool
+{
+public:
+
+    /// Pool statistics
+    struct Stats {
+        uint64_t hits       = 0;    /// Voices served from idle ones
+        uint64_t misses     = 0;    /// Voices that had to be built
+        uint64_t reclaims   = 0;    /// Idle voices destroyed to make room
+        uint64_t refusals   = 0;    /// Builds refused due to the budget
+        size_t   liveVoices = 0;    /// Voices currently built
+        size_t   peakVoices = 0;    /// Maximum of liveVoices
+        size_t   memory     = 0;    /// Estimated memory of built voices [B]
+        double   buildTime  = 0.0;  /// Total voice build time [s]
+    };
+
+    /// Constructor. Limits of 0 mean no limit. Starts the worker thread.
+    VoicePool (size_t a_MaxVoices = 0, size_t a_MaxMemory = 0);
+    /// Destructor. Stops the worker thread.
+    ~VoicePool ();
+
+    /// Sets the maximum count of built voices and their estimated memory
+    /// in bytes. Limits of 0 mean no limit. Voices above new limits are not
+    /// destroyed until reclaimed.
+    void setLimits (size_t a_MaxVoices, size_t a_MaxMemory);
+
+    /// Enables building voices on the worker thread (default). When
+    /// disabled instruments build voices synchronously, as needed, which
+    /// keeps rendering reproducible.
+    void setBackgroundBuilds (bool a_Enable);
+    /// Returns true when voices are built on the worker thread
+    bool hasBackgroundBuilds () const;
+
+    /// Registers an instrument as a source of idle voices and a client of
+    /// the worker
+    void addInstrument    (Instrument* a_Instrument);
+    /// Unregisters an instrument. Waits until the worker is done with it.
+    void removeInstrument (Instrument* a_Instrument);
+
+    /// Reserves the budget for a new voice of the given estimated memory.
+    /// Reclaims idle voices of registered instruments if needed and allowed.
+    /// Returns false when there is nothing left to reclaim.
+    bool acquire (size_t a_Memory, bool a_Reclaim = true);
+    /// Returns the budget of a destroyed voice
+    void release (size_t a_Memory);
+
+    /// Records a voice served from an idle one
+    void recordHit   ();
+    /// Records a voice build and its duration [s]
+    void recordBuild (double a_Time);
+
+    /// Returns the statistics
+    const Stats& getStats () const;
+
+    /// Wakes the worker up to service instruments. Does not block, may be
+    /// called from the audio thread.
+    void notify ();
+
+protected:
+
+    /// Returns true if a voice of the given memory fits in the budget
+    bool fits (size_t a_Memory) const;
+
+    /// Worker thread body
+    void worker ();
+
+    /// Maximum count of built voices
+    size_t m_MaxVoices;
+    /// Maximum estimated memory of built voices [B]
+    size_t m_MaxMemory;
+
+    /// Registered instruments
+    std::vector<Instrument*> m_Instruments;
+
+    /// Statistics
+    Stats m_Stats;
+
+    /// Background builds enabled flag
+    bool m_Background = true;
+
+    /// Worker thread
+    std::thread             m_Thread;
+    /// Guards the instrument list against the worker
+    std::mutex              m_Lock;
+    /// Worker wake-up
+    std::condition_variable m_Wakeup;
+    /// Set when there is work for the worker
+    std::atomic<bool>       m_Work;
+    /// Set to stop the worker
+    bool                    m_Stop = false;
+};
+
+// ============================================================================
+
+}; // Instrument
+
+#endif // INSTRUMENT_VOICE_POOL_HH
@@ -0,0 +1,60 @@
+#include "controller_state.hh"
+
+#include <algorithm>
+
+namespace MIDI {
+
+// ============================================================================
+
+constexpr size_t  ControllerState::COUNT;
+constexpr int32_t ControllerState::UNSET;
+
+// ============================================================================
+
+ControllerState::ControllerState () {
+    std::fill(m_Values, m_Values + COUNT, UNSET);
+}
+
+// ============================================================================
+
+void ControllerState::beginBuffer () {
+    m_Changes.clear();
+}
+
+void ControllerState::update (const Event& a_Event) {
+
+    uint32_t param = a_Event.data.ctrl.param;
+    if (param >= COUNT) {
+        return;
+    }
+
+    int32_t value = a_Event.data.ctrl.value;
+    m_Changes.push_back(Change {a_Event.time, param, value, m_Values[param]});
+    m_Values[param] = value;
+}
+
+// ============================================================================
+
+int32_t ControllerState::getValue (uint32_t a_Param) const {
+    return (a_Param < COUNT) ? m_Values[a_Param] : UNSET;
+}
+
+int32_t ControllerState::getStartValue (uint32_t a_Param) const {
+
+    // The value before the first change in this buffer
+    for (auto& change : m_Changes) {
+        if (change.param == a_Param) {
+            return change.previous;
+        }
+    }
+
+    return getValue(a_Param);
+}
+
+const std::vector<ControllerState::Change>& ControllerState::getChanges () const {
+    return m_Changes;
+}
+
+// ============================================================================
+
+}; // MIDI
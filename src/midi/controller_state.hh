@@ -0,0 +1,62 @@
+#ifndef MIDI_CONTROLLER_STATE_HH
+#define MIDI_CONTROLLER_STATE_HH
+
+#include "event.hh"
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace MIDI {
+
+// ============================================================================
+
+/// Values of MIDI controllers shared by all voices of an instrument, along
+/// with the list of changes within the buffer being processed. Readers get
+/// the value at the buffer start and apply changes at their sample times.
+class ControllerState {
+public:
+
+    /// Count of controllers
+    static constexpr size_t  COUNT = 128;
+    /// Value of a controller that has not been set yet
+    static constexpr int32_t UNSET = -1;
+
+    /// A controller change
+    struct Change {
+        int64_t  time;      /// Sample offset within the buffer
+        uint32_t param;     /// Controller index
+        int32_t  value;     /// New value
+        int32_t  previous;  /// Value before the change
+    };
+
+    /// Constructor
+    ControllerState ();
+
+    /// Starts a new buffer, clears the change list
+    void beginBuffer ();
+    /// Applies a controller event. Events within a buffer must be pushed in
+    /// time order. Controllers outside of the range are ignored.
+    void update (const Event& a_Event);
+
+    /// Returns the current value of a controller
+    int32_t getValue      (uint32_t a_Param) const;
+    /// Returns the value of a controller at the start of the buffer
+    int32_t getStartValue (uint32_t a_Param) const;
+    /// Returns changes within the buffer in time order
+    const std::vector<Change>& getChanges () const;
+
+protected:
+
+    /// Current values
+    int32_t m_Values[COUNT];
+    /// Changes within the buffer
+    std::vector<Change> m_Changes;
+};
+
+// ============================================================================
+
+}; // MIDI
+
+#endif // MIDI_CONTROLLER_STATE_HH
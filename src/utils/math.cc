@@ -5,6 +5,65 @@ namespace Math {
 
 // ============================================================================
 
+double sinc (double x) {
+    if (fabs(x) < 1e-9) {
+        return 1.0;
+    }
+
+    const double px = 3.141592653589793 * x;
+    return sin(px) / px;
+}
+
+double besselI0 (double x) {
+
+    // Power series, converges quickly for the arguments used in windows
+    double sum  = 1.0;
+    double term = 1.0;
+    for (int k=1; k<32; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum  += term;
+    }
+
+    return sum;
+}
+
+double kaiser (double x, double a_Beta) {
+    if (fabs(x) >= 1.0) {
+        return 0.0;
+    }
+
+    return besselI0(a_Beta * sqrt(1.0 - x * x)) / besselI0(a_Beta);
+}
+
+// ============================================================================
+
+void exp2 (float* a_Dst, const float* a_Src, size_t a_Count) {
+    for (size_t i=0; i<a_Count; ++i) {
+        a_Dst[i] = fastExp2(a_Src[i]);
+    }
+}
+
+void log2 (float* a_Dst, const float* a_Src, size_t a_Count) {
+    for (size_t i=0; i<a_Count; ++i) {
+        a_Dst[i] = fastLog2(a_Src[i]);
+    }
+}
+
+// ============================================================================
+
+void log2lin (float* a_Dst, const float* a_Src, size_t a_Count) {
+    for (size_t i=0; i<a_Count; ++i) {
+        a_Dst[i] = fastLog2lin(a_Src[i]);
+    }
+}
+
+void cvToFrequency (float* a_Dst, const float* a_Src, size_t a_Count,
+                    float a_Offset)
+{
+    for (size_t i=0; i<a_Count; ++i) {
+        a_Dst[i] = fastCvToFrequency(a_Src[i] + a_Offset);
+    }
+}
 
 // ============================================================================
 
@@ -37,6 +37,106 @@ inline float lin2log (const float& k) {
 
 // ============================================================================
 
+/// Fast 2^x. Polynomial approximation, max. relative error <2e-7 over the
+/// whole valid range and exact for integers. The input is clamped to
+/// [-126, 127] so that the result stays a normal number, which matters when
+/// denormals are flushed to zero. Branch-free so that loops calling it can
+/// be vectorized by the compiler.
+inline float fastExp2 (float x) {
+
+    x = (x < -126.0f) ? -126.0f : x;
+    x = (x >  127.0f) ?  127.0f : x;
+
+    // Split into integer and fractional part (floor without a libm call)
+    int32_t i = (int32_t)x;
+    i -= (x < (float)i) ? 1 : 0;
+    float   f = x - (float)i;
+
+    // 2^f for f in [0, 1). The constant term is fixed to 1 so that p(0) is
+    // exact and the result never drops below 2^i.
+    float p = 1.8671155e-3f;
+    p = p * f + 9.0170614e-3f;
+    p = p * f + 5.5799890e-2f;
+    p = p * f + 2.4016446e-1f;
+    p = p * f + 6.9315130e-1f;
+    p = p * f + 1.0f;
+
+    // Scale by 2^i directly in the exponent field
+    union { float f; int32_t i; } u;
+    u.f  = p;
+    u.i += i << 23;
+
+    return u.f;
+}
+
+/// Fast log2(x) for x > 0. Series approximation, the error is within about
+/// one ulp of the result (<6e-7 absolute for x in [1e-3, 1e3]). Branch-free,
+/// does not handle denormals, zero, infinity or NaN.
+inline float fastLog2 (float x) {
+
+    // Split into exponent and mantissa in [sqrt(2)/2, sqrt(2))
+    union { float f; int32_t i; } u;
+    u.f = x;
+
+    int32_t mant = u.i & 0x007FFFFF;
+    int32_t high = (mant > 0x003504F3) ? 1 : 0; // mantissa > sqrt(2)
+
+    float e = (float)(((u.i >> 23) & 0xFF) - 127 + high);
+    u.i = mant | ((127 - high) << 23);
+    float m = u.f;
+
+    // ln(m) = 2 * atanh(t), t = (m - 1) / (m + 1), |t| <= 0.172
+    float t  = (m - 1.0f) / (m + 1.0f);
+    float t2 = t * t;
+
+    float p = 1.0f / 9.0f;
+    p = p * t2 + 1.0f / 7.0f;
+    p = p * t2 + 1.0f / 5.0f;
+    p = p * t2 + 1.0f / 3.0f;
+    p = p * t2 + 1.0f;
+
+    return e + (2.0f * 1.442695041f) * t * p; // 1 / ln(2)
+}
+
+/// Fast decibel gain to scaling factor
+inline float fastLog2lin (float gain) {
+    return fastExp2(gain * (3.321928095f / 20.0f)); // log2(10) / 20
+}
+
+/// Fast control voltage to frequency in Hz assuming 1V/octave, 0V at A0.
+inline float fastCvToFrequency (float cv) {
+    return 27.50f * fastExp2(cv);
+}
+
+// ============================================================================
+
+/// Normalized sinc, sin(pi * x) / (pi * x). For filter design.
+double sinc (double x);
+
+/// Zeroth order modified Bessel function of the first kind. For Kaiser
+/// window computation.
+double besselI0 (double x);
+
+/// Kaiser window of the given shape at x in [-1, 1], zero outside
+double kaiser (double x, double a_Beta);
+
+// ============================================================================
+
+/// Block 2^x, see fastExp2()
+void exp2 (float* a_Dst, const float* a_Src, size_t a_Count);
+/// Block log2(x), see fastLog2()
+void log2 (float* a_Dst, const float* a_Src, size_t a_Count);
+
+/// Block decibel gain to scaling factor conversion. May operate in place.
+void log2lin (float* a_Dst, const float* a_Src, size_t a_Count);
+
+/// Block control voltage to frequency conversion, adds the given offset to
+/// the CV. May operate in place.
+void cvToFrequency (float* a_Dst, const float* a_Src, size_t a_Count,
+                    float a_Offset = 0.0f);
+
+// ============================================================================
+
 }; // Math
 }; // Utils
 
@@ -0,0 +1,101 @@
+#include "random.hh"
+
+#include <cstring>
+
+namespace Utils {
+
+// ============================================================================
+
+namespace {
+
+/// SplitMix64, used to expand a seed into the generator state
+inline uint64_t splitMix64 (uint64_t& a_State) {
+    uint64_t z = (a_State += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/// Rotates left
+inline uint32_t rotl (uint32_t x, int k) {
+    return (x << k) | (x >> (32 - k));
+}
+
+}; // Anonymous
+
+// ============================================================================
+
+Random::Random (uint64_t a_Seed) {
+    seed(a_Seed);
+}
+
+void Random::seed (uint64_t a_Seed) {
+
+    uint64_t sm = a_Seed;
+    for (size_t l=0; l<LANES; ++l) {
+        uint64_t a = splitMix64(sm);
+        uint64_t b = splitMix64(sm);
+
+        m_State[0][l] = (uint32_t)(a);
+        m_State[1][l] = (uint32_t)(a >> 32);
+        m_State[2][l] = (uint32_t)(b);
+        m_State[3][l] = (uint32_t)(b >> 32);
+
+        // The all-zero state is invalid
+        if ((a | b) == 0) {
+            m_State[0][l] = 1;
+        }
+    }
+}
+
+// ============================================================================
+
+void Random::next (float* a_Dst) {
+
+    uint32_t* s0 = m_State[0];
+    uint32_t* s1 = m_State[1];
+    uint32_t* s2 = m_State[2];
+    uint32_t* s3 = m_State[3];
+
+    for (size_t l=0; l<LANES; ++l) {
+
+        // xoshiro128+
+        uint32_t r = s0[l] + s3[l];
+        uint32_t t = s1[l] << 9;
+
+        s2[l] ^= s0[l];
+        s3[l] ^= s1[l];
+        s1[l] ^= s2[l];
+        s0[l] ^= s3[l];
+        s2[l] ^= t;
+        s3[l]  = rotl(s3[l], 11);
+
+        // Use the upper 23 bits as the mantissa of a float in [2, 4)
+        // and map it to [-1, 1)
+        uint32_t bits = (r >> 9) | 0x40000000;
+
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        a_Dst[l] = f - 3.0f;
+    }
+}
+
+void Random::uniform (float* a_Dst, size_t a_Count) {
+
+    // Full groups
+    size_t i = 0;
+    for (; i + LANES <= a_Count; i += LANES) {
+        next(a_Dst + i);
+    }
+
+    // Remainder
+    if (i < a_Count) {
+        alignas(32) float tmp[LANES];
+        next(tmp);
+        memcpy(a_Dst + i, tmp, (a_Count - i) * sizeof(float));
+    }
+}
+
+// ============================================================================
+
+}; // Utils
@@ -0,0 +1,46 @@
+#ifndef UTILS_RANDOM_HH
+#define UTILS_RANDOM_HH
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Utils {
+
+// ============================================================================
+
+/// A fast pseudo random number generator producing a buffer at a time. Runs
+/// LANES independent xoshiro128+ streams side by side so that the update
+/// loop vectorizes. The state is small (128 bytes) and the output sequence
+/// depends only on the seed.
+class Random {
+public:
+
+    /// Number of parallel streams
+    static constexpr size_t LANES = 8;
+
+    /// Default seed
+    static constexpr uint64_t DEFAULT_SEED = 5489;
+
+    /// Constructor
+    Random (uint64_t a_Seed = DEFAULT_SEED);
+
+    /// Reinitializes the generator state from the seed
+    void seed (uint64_t a_Seed);
+
+    /// Fills the buffer with uniformly distributed values in [-1, 1)
+    void uniform (float* a_Dst, size_t a_Count);
+
+protected:
+
+    /// Advances all streams, stores LANES values in [-1, 1)
+    void next (float* a_Dst);
+
+    /// Generator state, lane minor
+    uint32_t m_State[4][LANES];
+};
+
+// ============================================================================
+
+}; // Utils
+
+#endif // UTILS_RANDOM_HH
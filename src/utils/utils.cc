@@ -46,6 +46,33 @@ float stof (const std::string& a_Str) {
 
 // ============================================================================
 
+uint32_t hashString (const std::string& a_String) {
+    uint32_t hash = 2166136261U;
+
+    for (auto c : a_String) {
+        hash ^= (uint8_t)c;
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+uint32_t mixSeed (uint32_t a_Seed, uint32_t a_Value) {
+
+    // Boost style combine followed by the murmur3 finalizer
+    uint32_t x = a_Seed ^ (a_Value + 0x9E3779B9U + (a_Seed << 6) + (a_Seed >> 2));
+
+    x ^= x >> 16;
+    x *= 0x85EBCA6BU;
+    x ^= x >> 13;
+    x *= 0xC2B2AE35U;
+    x ^= x >> 16;
+
+    return x;
+}
+
+// ============================================================================
+
 int noteToIndex(const std::string& a_Note) {
     // https://www.inspiredacoustics.com/en/MIDI_note_numbers_and_center_frequencies
 
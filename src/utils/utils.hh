@@ -21,6 +21,15 @@ float stof (const std::string& a_Str);
 
 // ============================================================================
 
+/// Returns a 32-bit FNV-1a hash of a string. Unlike std::hash the result is
+/// the same on every platform.
+uint32_t hashString (const std::string& a_String);
+
+/// Combines two values into a well distributed 32-bit random seed
+uint32_t mixSeed (uint32_t a_Seed, uint32_t a_Value);
+
+// ============================================================================
+
 /// Returns a MIDI note index for the given note provided as string in english
 /// notation.
 int noteToIndex (const std::string& a_Note);